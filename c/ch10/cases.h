@@ -1,6 +1,18 @@
 #ifndef CASES_H_
 #define CASES_H_
 
+// Each coefficient function  c(u,x,y)  below also has a batched version
+//     c_batch(n,u,x,y,out)
+// which sets out[i] = c(u[i],x[i],y[i]) for i=0,...,n-1.  Because c() is
+// visible here, the compiler can inline it and vectorize the loop.
+#define BATCHED(c) \
+void c##_batch(PetscInt n, const PetscReal u[], const PetscReal x[], \
+               const PetscReal y[], PetscReal out[]) { \
+    PetscInt i; \
+    for (i = 0; i < n; i++) \
+        out[i] = c(u[i],x[i],y[i]); \
+}
+
 // -----------------------------------------------------------------------------
 // CASE 0
 // LINEAR PROBLEM, NONHOMOGENEOUS DIRICHLET, HOMOGENEOUS NEUMANN
@@ -9,11 +21,23 @@
 PetscReal a_lin(PetscReal u, PetscReal x, PetscReal y) {
     return 1.0;
 }
+BATCHED(a_lin)
+
+// derivative of a_lin() with respect to u:
+PetscReal dadu_lin(PetscReal u, PetscReal x, PetscReal y) {
+    return 0.0;
+}
 
 // manufactured from a_lin(), uexact_lin():
 PetscReal f_lin(PetscReal u, PetscReal x, PetscReal y) {
     return 2.0 * x + 3.0 * y * y;
 }
+BATCHED(f_lin)
+
+// derivative of f_lin() with respect to u:
+PetscReal dfdu_lin(PetscReal u, PetscReal x, PetscReal y) {
+    return 0.0;
+}
 
 PetscReal uexact_lin(PetscReal x, PetscReal y) {
     const PetscReal y2 = y * y;
@@ -38,6 +62,11 @@ PetscReal gN_lin(PetscReal x, PetscReal y) {
 PetscReal a_nonlin(PetscReal u, PetscReal x, PetscReal y) {
     return 1.0 + u * u;
 }
+BATCHED(a_nonlin)
+
+PetscReal dadu_nonlin(PetscReal u, PetscReal x, PetscReal y) {
+    return 2.0 * u;
+}
 
 // manufactured from a_nonlin(), uexact_lin()
 PetscReal f_nonlin(PetscReal udrop, PetscReal x, PetscReal y) {
@@ -48,6 +77,9 @@ PetscReal f_nonlin(PetscReal udrop, PetscReal x, PetscReal y) {
     return - 2.0 * y4 * u - 2.0 * u * v * v
            + (1.0 + u * u) * (2.0 * x + 3.0 * y2);
 }
+BATCHED(f_nonlin)
+
+// dfdu_nonlin = dfdu_lin  because f_nonlin() ignores u
 
 // uexact_nonlin = uexact_lin
 // gD_nonlin = gD_lin
@@ -79,11 +111,17 @@ PetscReal gN_linneu(PetscReal x, PetscReal y) {
 PetscReal a_square(PetscReal u, PetscReal x, PetscReal y) {
     return 1.0;
 }
+BATCHED(a_square)
+
+// dadu_square = dadu_lin
 
 // manufactured from a_square(), uexact_square():
 PetscReal f_square(PetscReal u, PetscReal x, PetscReal y) {
     return x * exp(y);  // note  f = - (u_xx + u_yy) = - u
 }
+BATCHED(f_square)
+
+// dfdu_square = dfdu_lin
 
 PetscReal uexact_square(PetscReal x, PetscReal y) {
     return - x * exp(y);
@@ -105,10 +143,16 @@ PetscReal gD_square(PetscReal x, PetscReal y) {
 PetscReal a_koch(PetscReal u, PetscReal x, PetscReal y) {
     return 1.0;
 }
+BATCHED(a_koch)
+
+// dadu_koch = dadu_lin
 
 PetscReal f_koch(PetscReal u, PetscReal x, PetscReal y) {
     return 2.0;
 }
+BATCHED(f_koch)
+
+// dfdu_koch = dfdu_lin
 
 PetscReal gD_koch(PetscReal x, PetscReal y) {
     return 0.0;
@@ -2,6 +2,9 @@
 #
 # (C) 2014-2020 Ed Bueler
 
+# The same mesh can be created in memory by UMCreateStructured() in um.c;
+# see option -un_structured of unfem.
+
 import sys, argparse
 import numpy as np
 import PetscBinaryIO  # may use link
@@ -9,8 +9,12 @@
 #   http://gmsh.info/doc/texinfo/gmsh.html#MSH-file-format
 #   http://gmsh.info/doc/texinfo/gmsh.html#MSH-file-format-version-2-_0028Legacy_0029
 
+# For large meshes it is faster to let unfem read the .msh file itself, by
+# UMReadGmsh() in um.c, which also reads binary .msh files:
+#    $ ./unfem -un_mesh meshes/trap.msh
+
 # example: put PETSc Vec with locations (node coordinates x,y) in meshes/trap.vec
-# and PETSc ISs (e,bf,ns) in meshes/trap.is
+# and PETSc ISs (e,bf,ns) in meshes/trap.is; add -um to also write meshes/trap.um
 #    $ make petscPyScripts
 #    $ gmsh -2 meshes/trap.geo
 #    $ ./msh2petsc.py meshes/trap.msh
@@ -88,6 +92,8 @@ Needs link to ${PETSC_DIR}/lib/petsc/bin/PetscBinaryIO.py.''')
     # required positional filename
     parser.add_argument('-v', default=False, action='store_true',
                         help='verbose output for debugging')
+    parser.add_argument('-um', default=False, action='store_true',
+                        help='also write single mesh file with .um extension; see umfile.py')
     parser.add_argument('inname', metavar='FILE',
                         help='input file name with .msh extension')
     args = parser.parse_args()
@@ -147,3 +153,9 @@ Needs link to ${PETSC_DIR}/lib/petsc/bin/PetscBinaryIO.py.''')
     IS = PetscBinaryIO.IS
     petsc.writeBinaryFile(isoutname,[e.view(IS),bf.view(IS),ns.view(IS)])
 
+    if args.um:
+        from umfile import writeum
+        umoutname = outroot + '.um'
+        print('  writing all of the above to single mesh file %s ...' % umoutname)
+        writeum(umoutname,xy,e,bf,ns)
+
@@ -2,6 +2,7 @@
 
 # generate refining trapezoidal unstructured meshes using Gmsh and msh2petsc.py
 # refinement is by splitting elements using "gmsh -refine"
+# (unfem can do the same refinement in memory; see option -un_refine)
 
 # run "make test" first to get links to PETSc python scripts for binary files
 
@@ -0,0 +1,41 @@
+#!/bin/bash
+set -e
+
+# adaptive versus uniform refinement for unfem:  the error (case 1) or the
+#   estimated error (case 4, no exact solution) against the number of nodes;
+#   adaptive refinement should reach a given error with far fewer nodes
+# run as:
+#   cd c/ch10/
+#   make unfem meshes/trap1.vec meshes/trap1.is koch/koch2.vec koch/koch2.is
+#   cd study/
+#   ./unfem-amr.sh &> unfem-amr.txt
+# use PETSC_ARCH with --with-debugging=0
+
+function run() {
+    CMD="../unfem $1 -snes_rtol 1.0e-10 -ksp_rtol 1.0e-10"
+    echo "COMMAND:  $CMD"
+    rm -rf tmp.txt
+    $CMD &> tmp.txt
+    grep "adaptive step" tmp.txt | tail -n 1 || true
+    grep "result" tmp.txt
+}
+
+# with a huge -un_amr_tol one adaptive step only reports the estimate, so the
+#   uniform runs give estimates too
+
+# case 1 (nonlinear) on the trapezoid; uniform refinement is meshes/trapN
+UNIFORM="-un_amr_steps 1 -un_amr_tol 1.0e10"
+for LEV in 0 1 2 3 4 5 6; do
+    run "-un_case 1 -un_mesh ../meshes/trap1 -un_refine $LEV $UNIFORM"
+done
+for STEPS in 2 4 8 12 16 20 24; do
+    run "-un_case 1 -un_mesh ../meshes/trap1 -un_amr_steps $STEPS"
+done
+
+# case 4 on the Koch snowflake
+for LEV in 0 1 2 3 4; do
+    run "-un_case 4 -un_mesh ../koch/koch2 -un_refine $LEV $UNIFORM"
+done
+for STEPS in 2 4 8 12 16 20; do
+    run "-un_case 4 -un_mesh ../koch/koch2 -un_amr_steps $STEPS"
+done
@@ -0,0 +1,28 @@
+#!/bin/bash
+set -e
+
+# residual evaluation time for unfem on meshes/trap12, comparing the scalar
+# element loop with the batched (-un_batch) one, with and without the
+# geometry cache; run as:
+#   cd c/ch10/
+#   make unfem                        # use PETSC_ARCH with --with-debugging=0
+#   ./refinetraps.sh meshes/trap 12   # generate meshes/trapN.{is,vec} for N=1,...,12
+#   cd study/
+#   ./unfem-batch.sh &> unfem-batch.txt
+# compare the "Residual eval" stage times and the SNESFunctionEval counts
+
+function run() {
+    CMD="../unfem -un_case $1 -un_mesh ../meshes/trap12 $2 -pc_type gamg -snes_converged_reason -log_view"
+    echo "COMMAND:  $CMD"
+    rm -rf tmp.txt
+    $CMD &> tmp.txt
+    grep "Nonlinear solve" tmp.txt
+    grep "Residual eval  :" tmp.txt
+    grep "SNESFunctionEval" tmp.txt
+}
+
+for CASE in 0 1; do
+    for OPTS in "" "-un_batch" "-un_cache_geometry" "-un_cache_geometry -un_batch"; do
+        run $CASE "$OPTS -un_quaddegree 3"
+    done
+done
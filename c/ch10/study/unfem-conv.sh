@@ -2,7 +2,9 @@
 set -e
 
 # convergence and iterations for case 0,1,2 for unfem
-# generate meshes/trapN.{is,vec} for N=1,...,10 first
+# generate meshes/trapN.{is,vec} for N=1,...,10 first, or, because these
+#   are uniform refinements of trap1, replace "-un_mesh ../meshes/trapN"
+#   by "-un_mesh ../meshes/trap1 -un_refine N-1" to refine in memory
 # run as:
 #   ./unfem-conv.sh &> unfem-conv.txt
 # use PETSC_ARCH with --with-debugging=0 (for speed; time not measured)
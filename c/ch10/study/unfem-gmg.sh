@@ -0,0 +1,44 @@
+#!/bin/bash
+set -e
+
+# solver time and run-time stage fractions for case 0 of unfem, comparing
+# CG+GAMG with CG+MG over the in-memory refinement hierarchy (-un_gmg);
+# all runs refine meshes/trap1 in memory, so only it is needed;  run as:
+#   cd c/ch10/
+#   make unfem                        # use PETSC_ARCH with --with-debugging=0
+#   ./refinetraps.sh meshes/trap 1    # generate meshes/trap1.{is,vec}
+#   cd study/
+#   ./unfem-gmg.sh &> unfem-gmg.txt
+
+function run() {
+    CMD="../unfem -un_case 0 -un_mesh ../meshes/trap1 -un_refine $1 $2 -snes_type ksponly -ksp_rtol 1.0e-10 -ksp_converged_reason -log_view"
+    echo "COMMAND:  $CMD"
+    rm -rf tmp.txt
+    $CMD &> tmp.txt
+    grep "Linear solve" tmp.txt
+    grep "PC is" tmp.txt
+    grep "result" tmp.txt
+    grep "Time (sec):     " tmp.txt
+    # read time percentages from these lines
+    grep "Read mesh      :" tmp.txt
+    grep "Set-up         :" tmp.txt
+    grep "Solver         :" tmp.txt
+    # multigrid set-up cost within the solver stage
+    grep "PCSetUp        " tmp.txt
+}
+
+# case 0 with CG+GAMG; aggregation is part of PCSetUp
+for REF in 2 4 6 8 10; do
+    run $REF "-pc_type gamg"
+done
+
+# same, also saving the GAMG interpolation from the finest level
+for REF in 2 4 6 8 10; do
+    run $REF "-pc_type gamg -un_gamg_save_pint_binary pint.dat"
+done
+rm -f pint.dat pint.dat.info
+
+# case 0 with CG+MG using P1 interpolation and Galerkin coarse operators
+for REF in 2 4 6 8 10; do
+    run $REF "-un_gmg"
+done
@@ -2,10 +2,12 @@
 set -e
 
 # solver iterations and flops for case 1 of unfem using CG+AMG and one of
-# three nonlinear strategies:
+# five nonlinear strategies:
 #   Picard (analytical matrix) iteration
 #   -snes_fd_color
 #   -snes_mf_operator with Picard as preconditioner material
+#   -un_newton (analytical Newton matrix)
+#   -un_matfree -un_newton (matrix-free Newton with Picard preconditioner)
 # (note: individual runs will show the very different residual norm histories)
 
 # run as:
@@ -27,6 +29,7 @@ function run() {
     grep "case 1 result" tmp.txt
     grep "Flop:           " tmp.txt
     grep "Time (sec):     " tmp.txt
+    grep "SNESFunctionEval" tmp.txt
 }
 
 echo "********** Picard ***********"
@@ -47,4 +50,15 @@ for LEV in 3 4 5 6 7 8 9; do   # LEV=10 generates DIVERGED_ITS error on 4th SNES
 done
 echo
 
+echo "********** Newton with analytical matrix ***********"
+for LEV in 3 4 5 6 7 8 9 10 11; do
+    run $LEV "-un_newton"
+done
+echo
+
+echo "********** matrix-free Newton with Picard matrix ***********"
+for LEV in 3 4 5 6 7 8 9 10 11; do
+    run $LEV "-un_matfree -un_newton"
+done
+echo
 
@@ -0,0 +1,33 @@
+#!/bin/bash
+set -e
+
+# accuracy per degree of freedom, and time, for P1 versus P2 elements in
+# cases 0 and 2 of unfem, on uniform refinements of meshes/trap1 and
+# meshes/trapneu1;  run as:
+#   cd c/ch10/
+#   make unfem                        # use PETSC_ARCH with --with-debugging=0
+#   make test                         # generates meshes/trap1, trapneu1
+#   cd study/
+#   ./unfem-p2.sh &> unfem-p2.txt
+# the "result" lines report N (= degrees of freedom) and the error
+
+function run() {
+    CMD="../unfem -un_case $1 -un_mesh ../meshes/$2 -un_refine $3 $4 -snes_type ksponly -ksp_rtol 1.0e-12 -ksp_converged_reason -log_view"
+    echo "COMMAND:  $CMD"
+    rm -rf tmp.txt
+    $CMD &> tmp.txt
+    grep "Linear solve" tmp.txt
+    grep "result" tmp.txt
+    grep "Time (sec):     " tmp.txt
+}
+
+# P1 at one more level than P2 gives similar N
+for REF in 1 2 3 4 5 6 7 8; do
+    run 0 trap1 $REF ""
+    run 0 trap1 $((REF-1)) "-un_p2"
+done
+
+for REF in 1 2 3 4 5 6 7 8; do
+    run 2 trapneu1 $REF ""
+    run 2 trapneu1 $((REF-1)) "-un_p2"
+done
@@ -0,0 +1,28 @@
+#!/bin/bash
+set -e
+
+# residual evaluation time for case 1 of unfem on meshes/trap12 using
+# -un_color_elements and 1,2,4,...,32 OpenMP threads; run as:
+#   cd c/ch10/
+#   make unfem                        # use PETSC_ARCH with --with-debugging=0 --with-openmp
+#   ./refinetraps.sh meshes/trap 12   # generate meshes/trapN.{is,vec} for N=1,...,12
+#   cd study/
+#   ./unfem-threads.sh &> unfem-threads.txt
+# speedup is the "Residual eval" stage time for 1 thread divided by that for
+# T threads; the first run is the uncolored serial loop for comparison
+
+function run() {
+    CMD="../unfem -un_case 1 -un_mesh ../meshes/trap12 $2 -pc_type gamg -snes_converged_reason -log_view"
+    echo "COMMAND:  OMP_NUM_THREADS=$1 $CMD"
+    rm -rf tmp.txt
+    OMP_NUM_THREADS=$1 $CMD &> tmp.txt
+    grep "Nonlinear solve" tmp.txt
+    grep "case 1 result" tmp.txt
+    grep "Residual eval  :" tmp.txt
+    grep "SNESFunctionEval" tmp.txt
+}
+
+run 1 ""
+for T in 1 2 4 8 16 32; do
+    run $T "-un_color_elements"
+done
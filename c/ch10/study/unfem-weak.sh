@@ -0,0 +1,31 @@
+#!/bin/bash
+set -e
+
+# weak scaling of case 3 of unfem on the structured mesh of the unit square,
+# created in memory by -un_structured so that no mesh files are read; each
+# process has about 250^2 nodes; run as:
+#   cd c/ch10/
+#   make unfem                        # use PETSC_ARCH with --with-debugging=0
+#   cd study/
+#   ./unfem-weak.sh &> unfem-weak.txt
+# with perfect weak scaling the "Solver" stage time is constant; "Read mesh"
+# is the time to generate the mesh
+
+function run() {
+    CMD="mpiexec -n $1 ../unfem -un_case 3 -un_structured $2 -snes_type ksponly -pc_type gamg -ksp_rtol 1.0e-10 -ksp_converged_reason -log_view"
+    echo "COMMAND:  $CMD"
+    rm -rf tmp.txt
+    $CMD &> tmp.txt
+    grep "Linear solve" tmp.txt
+    grep "result" tmp.txt
+    grep "Time (sec):     " tmp.txt
+    grep "Read mesh      :" tmp.txt
+    grep "Set-up         :" tmp.txt
+    grep "Solver         :" tmp.txt
+}
+
+# M^2 / P is about 250^2
+run 1 250
+run 4 500
+run 16 1000
+run 64 2000
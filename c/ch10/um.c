@@ -1,3 +1,9 @@
+#define _POSIX_C_SOURCE 200112L  // for mmap(), fstat(), open()
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <ctype.h>
 #include <petsc.h>
 #include "um.h"
 
@@ -9,6 +15,24 @@ PetscErrorCode UMInitialize(UM *mesh) {
     mesh->e = NULL;
     mesh->bf = NULL;
     mesh->ns = NULL;
+    mesh->em = NULL;
+    mesh->nsm = NULL;
+    mesh->Nedge = 0;
+    mesh->nvb = PETSC_FALSE;
+    mesh->perm = NULL;
+    mesh->Nown = 0;
+    mesh->Nloc = 0;
+    mesh->Kloc = 0;
+    mesh->Ploc = 0;
+    mesh->rstart = 0;
+    mesh->l2g = NULL;
+    mesh->ghostscatter = NULL;
+    mesh->geom = NULL;
+    mesh->ncolors = 0;
+    mesh->colorptr = NULL;
+    mesh->colorelems = NULL;
+    mesh->map = NULL;
+    mesh->mapsize = 0;
     return 0;
 }
 
@@ -17,6 +41,21 @@ PetscErrorCode UMDestroy(UM *mesh) {
     PetscCall(ISDestroy(&(mesh->e)));
     PetscCall(ISDestroy(&(mesh->bf)));
     PetscCall(ISDestroy(&(mesh->ns)));
+    PetscCall(ISDestroy(&(mesh->em)));
+    PetscCall(ISDestroy(&(mesh->nsm)));
+    PetscCall(ISDestroy(&(mesh->perm)));
+    PetscCall(ISLocalToGlobalMappingDestroy(&(mesh->l2g)));
+    PetscCall(VecScatterDestroy(&(mesh->ghostscatter)));
+    if (mesh->geom) {
+        PetscCall(PetscFree5(mesh->geom->absdetJ,mesh->geom->gx,mesh->geom->gy,
+                             mesh->geom->xq,mesh->geom->yq));
+        PetscCall(PetscFree(mesh->geom));
+    }
+    PetscCall(PetscFree2(mesh->colorptr,mesh->colorelems));
+    if (mesh->map) {
+        munmap(mesh->map,mesh->mapsize);
+        mesh->map = NULL;
+    }
     return 0;
 }
 
@@ -26,10 +65,10 @@ PetscErrorCode UMViewASCII(UM *mesh, PetscViewer viewer) {
     const PetscInt  *ae, *abf, *ans;
 
     PetscCall(PetscViewerASCIIPushSynchronized(viewer));
-    if (mesh->loc && (mesh->N > 0)) {
-        PetscCall(PetscViewerASCIISynchronizedPrintf(viewer,"%d nodes at (x,y) coordinates:\n",mesh->N));
+    if (mesh->loc && (mesh->Nloc > 0)) {
+        PetscCall(PetscViewerASCIISynchronizedPrintf(viewer,"%d nodes at (x,y) coordinates:\n",mesh->Nloc));
         PetscCall(VecGetArrayRead(mesh->loc,(const PetscReal **)&aloc));
-        for (n = 0; n < mesh->N; n++) {
+        for (n = 0; n < mesh->Nloc; n++) {
             PetscCall(PetscViewerASCIISynchronizedPrintf(viewer,"    %3d : (%g,%g)\n",
                                n,aloc[n].x,aloc[n].y));
         }
@@ -37,21 +76,30 @@ PetscErrorCode UMViewASCII(UM *mesh, PetscViewer viewer) {
     } else {
         PetscCall(PetscViewerASCIISynchronizedPrintf(viewer,"node coordinates empty or unallocated\n"));
     }
-    if (mesh->e && (mesh->K > 0)) {
-        PetscCall(PetscViewerASCIISynchronizedPrintf(viewer,"%d elements:\n",mesh->K));
+    if (mesh->e && (mesh->Kloc > 0)) {
+        PetscCall(PetscViewerASCIISynchronizedPrintf(viewer,"%d elements:\n",mesh->Kloc));
         PetscCall(ISGetIndices(mesh->e,&ae));
-        for (k = 0; k < mesh->K; k++) {
-            PetscCall(PetscPrintf(PETSC_COMM_WORLD,"    %3d : %3d %3d %3d\n",
+        for (k = 0; k < mesh->Kloc; k++) {
+            PetscCall(PetscViewerASCIISynchronizedPrintf(viewer,"    %3d : %3d %3d %3d\n",
                                k,ae[3*k+0],ae[3*k+1],ae[3*k+2]));
         }
         PetscCall(ISRestoreIndices(mesh->e,&ae));
     } else {
         PetscCall(PetscViewerASCIISynchronizedPrintf(viewer,"element index triples empty or unallocated\n"));
     }
-    if (mesh->bf && (mesh->N > 0)) {
-        PetscCall(PetscViewerASCIISynchronizedPrintf(viewer,"%d boundary flags at nodes (0 = interior, 1 = boundary, 2 = Dirichlet):\n",mesh->N));
+    if (mesh->em && (mesh->Kloc > 0)) {
+        PetscCall(PetscViewerASCIISynchronizedPrintf(viewer,"%d element edge node triples:\n",mesh->Kloc));
+        PetscCall(ISGetIndices(mesh->em,&ae));
+        for (k = 0; k < mesh->Kloc; k++) {
+            PetscCall(PetscViewerASCIISynchronizedPrintf(viewer,"    %3d : %3d %3d %3d\n",
+                               k,ae[3*k+0],ae[3*k+1],ae[3*k+2]));
+        }
+        PetscCall(ISRestoreIndices(mesh->em,&ae));
+    }
+    if (mesh->bf && (mesh->Nloc > 0)) {
+        PetscCall(PetscViewerASCIISynchronizedPrintf(viewer,"%d boundary flags at nodes (0 = interior, 1 = boundary, 2 = Dirichlet):\n",mesh->Nloc));
         PetscCall(ISGetIndices(mesh->bf,&abf));
-        for (n = 0; n < mesh->N; n++) {
+        for (n = 0; n < mesh->Nloc; n++) {
             PetscCall(PetscViewerASCIISynchronizedPrintf(viewer,"    %3d : %1d\n",
                                n,abf[n]));
         }
@@ -59,10 +107,10 @@ PetscErrorCode UMViewASCII(UM *mesh, PetscViewer viewer) {
     } else {
         PetscCall(PetscViewerASCIISynchronizedPrintf(viewer,"boundary flags empty or unallocated\n"));
     }
-    if (mesh->ns && (mesh->P > 0)) {
-        PetscCall(PetscViewerASCIISynchronizedPrintf(viewer,"%d Neumann boundary segments:\n",mesh->P));
+    if (mesh->ns && (mesh->Ploc > 0)) {
+        PetscCall(PetscViewerASCIISynchronizedPrintf(viewer,"%d Neumann boundary segments:\n",mesh->Ploc));
         PetscCall(ISGetIndices(mesh->ns,&ans));
-        for (n = 0; n < mesh->P; n++) {
+        for (n = 0; n < mesh->Ploc; n++) {
             PetscCall(PetscViewerASCIISynchronizedPrintf(viewer,"    %3d : %3d %3d\n",
                                n,ans[2*n+0],ans[2*n+1]));
         }
@@ -70,27 +118,221 @@ PetscErrorCode UMViewASCII(UM *mesh, PetscViewer viewer) {
     } else {
         PetscCall(PetscViewerASCIISynchronizedPrintf(viewer,"Neumann boundary segments empty or unallocated\n"));
     }
+    if (mesh->nsm && (mesh->Ploc > 0)) {
+        PetscCall(PetscViewerASCIISynchronizedPrintf(viewer,"%d Neumann boundary segment edge nodes:\n",mesh->Ploc));
+        PetscCall(ISGetIndices(mesh->nsm,&ans));
+        for (n = 0; n < mesh->Ploc; n++) {
+            PetscCall(PetscViewerASCIISynchronizedPrintf(viewer,"    %3d : %3d\n",
+                               n,ans[n]));
+        }
+        PetscCall(ISRestoreIndices(mesh->nsm,&ans));
+    }
     PetscCall(PetscViewerASCIIPopSynchronized(viewer));
     return 0;
 }
 
 
 PetscErrorCode UMViewSolutionBinary(UM *mesh, char *filename, Vec u) {
-    PetscInt       Nu;
+    PetscInt       Nu, rstart, rend, vend;
+    const PetscInt *aperm;
     PetscViewer viewer;
+    Vec         uvert, uorig;
+    VecScatter  toorig;
+    IS          isvert, isnew, isorig;
     PetscCall(VecGetSize(u,&Nu));
     if (Nu != mesh->N) {
         SETERRQ(PETSC_COMM_SELF,1,
            "incompatible sizes of u (=%d) and number of nodes (=%d)\n",Nu,mesh->N);
     }
+    // edge nodes from UMAddEdgeNodes() are numbered last; write only the
+    //   values at the vertices, which are the nodes of the mesh file
+    PetscCall(VecGetOwnershipRange(u,&rstart,&rend));
+    vend = PetscMax(rstart,PetscMin(rend,mesh->N - mesh->Nedge));
+    PetscCall(ISCreateStride(PETSC_COMM_WORLD,vend-rstart,rstart,1,&isvert));
+    PetscCall(VecGetSubVector(u,isvert,&uvert));
     PetscCall(PetscViewerBinaryOpen(PETSC_COMM_WORLD,filename,FILE_MODE_WRITE,&viewer));
-    PetscCall(VecView(u,viewer));
+    if (mesh->perm) {
+        // write in the node order of the mesh file, not the UMReorder() order
+        PetscCall(VecDuplicate(uvert,&uorig));
+        PetscCall(VecGetOwnershipRange(uvert,&rstart,&rend));
+        PetscCall(ISGetIndices(mesh->perm,&aperm));
+        PetscCall(ISCreateStride(PETSC_COMM_SELF,rend-rstart,rstart,1,&isnew));
+        PetscCall(ISCreateGeneral(PETSC_COMM_SELF,rend-rstart,aperm+rstart,
+                                  PETSC_COPY_VALUES,&isorig));
+        PetscCall(ISRestoreIndices(mesh->perm,&aperm));
+        PetscCall(VecScatterCreate(uvert,isnew,uorig,isorig,&toorig));
+        PetscCall(VecScatterBegin(toorig,uvert,uorig,INSERT_VALUES,SCATTER_FORWARD));
+        PetscCall(VecScatterEnd(toorig,uvert,uorig,INSERT_VALUES,SCATTER_FORWARD));
+        PetscCall(VecView(uorig,viewer));
+        PetscCall(VecScatterDestroy(&toorig));
+        PetscCall(ISDestroy(&isnew));
+        PetscCall(ISDestroy(&isorig));
+        PetscCall(VecDestroy(&uorig));
+    } else {
+        PetscCall(VecView(uvert,viewer));
+    }
     PetscCall(PetscViewerDestroy(&viewer));
+    PetscCall(VecRestoreSubVector(u,isvert,&uvert));
+    PetscCall(ISDestroy(&isvert));
+    return 0;
+}
+
+
+// open root.bin for collective raw writes; uses MPI-IO if PETSc has it, so
+//   each process writes its own part at its own offset
+static PetscErrorCode UMXDMFOpenBinary(UMXDMF *xdmf, PetscFileMode mode,
+                                       PetscViewer *viewer) {
+    char  filename[PETSC_MAX_PATH_LEN];
+    PetscCall(PetscSNPrintf(filename,sizeof(filename),"%s.bin",xdmf->root));
+    PetscCall(PetscViewerCreate(PETSC_COMM_WORLD,viewer));
+    PetscCall(PetscViewerSetType(*viewer,PETSCVIEWERBINARY));
+    PetscCall(PetscViewerFileSetMode(*viewer,mode));
+    PetscCall(PetscViewerBinarySkipInfo(*viewer));
+#if defined(PETSC_HAVE_MPIIO)
+    PetscCall(PetscViewerBinarySetUseMPIIO(*viewer,PETSC_TRUE));
+#endif
+    PetscCall(PetscViewerFileSetName(*viewer,filename));
+    return 0;
+}
+
+// write one <DataItem> referring to a block of root.bin
+static PetscErrorCode UMXDMFDataItem(PetscViewer viewer, const char *binname,
+                                     PetscInt rows, PetscInt cols,
+                                     PetscBool isint, size_t seek) {
+    if (cols > 1) {
+        PetscCall(PetscViewerASCIIPrintf(viewer,
+            "        <DataItem Dimensions=\"%d %d\"",rows,cols));
+    } else {
+        PetscCall(PetscViewerASCIIPrintf(viewer,
+            "        <DataItem Dimensions=\"%d\"",rows));
+    }
+    PetscCall(PetscViewerASCIIPrintf(viewer,
+        " NumberType=\"%s\" Precision=\"%d\" Format=\"Binary\" Endian=\"Big\""
+        " Seek=\"%llu\">%s</DataItem>\n",
+        isint ? "Int" : "Float",
+        isint ? (int)sizeof(PetscInt) : (int)sizeof(PetscReal),
+        (unsigned long long)seek,binname));
     return 0;
 }
 
+// (re)write root.xmf to describe the mesh and all fields so far
+static PetscErrorCode UMXDMFWriteDescriptor(UMXDMF *xdmf) {
+    char        filename[PETSC_MAX_PATH_LEN], binname[PETSC_MAX_PATH_LEN],
+                *base;
+    size_t      seek;
+    PetscInt    j;
+    PetscViewer viewer;
+    // data file is named relative to the directory of the descriptor
+    PetscCall(PetscSNPrintf(binname,sizeof(binname),"%s.bin",xdmf->root));
+    PetscCall(PetscStrrchr(binname,'/',&base));
+    PetscCall(PetscSNPrintf(filename,sizeof(filename),"%s.xmf",xdmf->root));
+    PetscCall(PetscViewerASCIIOpen(PETSC_COMM_WORLD,filename,&viewer));
+    PetscCall(PetscViewerASCIIPrintf(viewer,
+        "<?xml version=\"1.0\" ?>\n"
+        "<!DOCTYPE Xdmf SYSTEM \"Xdmf.dtd\" []>\n"
+        "<Xdmf Version=\"2.0\">\n"
+        "  <Domain>\n"
+        "    <Grid Name=\"mesh\" GridType=\"Uniform\">\n"
+        "      <Topology TopologyType=\"%s\" NumberOfElements=\"%d\">\n",
+        (xdmf->nen == 6) ? "Triangle_6" : "Triangle",xdmf->K));
+    seek = 2 * xdmf->N * sizeof(PetscReal);
+    PetscCall(UMXDMFDataItem(viewer,base,xdmf->K,xdmf->nen,PETSC_TRUE,seek));
+    PetscCall(PetscViewerASCIIPrintf(viewer,
+        "      </Topology>\n"
+        "      <Geometry GeometryType=\"XY\">\n"));
+    PetscCall(UMXDMFDataItem(viewer,base,xdmf->N,2,PETSC_FALSE,0));
+    PetscCall(PetscViewerASCIIPrintf(viewer,"      </Geometry>\n"));
+    seek += xdmf->nen * xdmf->K * sizeof(PetscInt);
+    for (j = 0; j < xdmf->nfields; j++) {
+        PetscCall(PetscViewerASCIIPrintf(viewer,
+            "      <Attribute Name=\"%s\" AttributeType=\"Scalar\" Center=\"Node\">\n",
+            xdmf->fieldname[j]));
+        PetscCall(UMXDMFDataItem(viewer,base,xdmf->N,1,PETSC_FALSE,seek));
+        PetscCall(PetscViewerASCIIPrintf(viewer,"      </Attribute>\n"));
+        seek += xdmf->N * sizeof(PetscReal);
+    }
+    PetscCall(PetscViewerASCIIPrintf(viewer,
+        "    </Grid>\n"
+        "  </Domain>\n"
+        "</Xdmf>\n"));
+    PetscCall(PetscViewerDestroy(&viewer));
+    return 0;
+}
+
+PetscErrorCode UMXDMFCreate(UM *mesh, const char *root, UMXDMF *xdmf) {
+    const PetscInt *ae, *aem;
+    const Node     *aloc;
+    PetscInt       *eg, k, l;
+    PetscViewer    viewer;
+    if (mesh->l2g == NULL) {
+        SETERRQ(PETSC_COMM_SELF,1,"mesh not distributed; call UMDistribute() first\n");
+    }
+    PetscCall(PetscStrncpy(xdmf->root,root,sizeof(xdmf->root)));
+    xdmf->N = mesh->N;
+    xdmf->K = mesh->K;
+    xdmf->nen = (mesh->em) ? 6 : 3;
+    xdmf->nfields = 0;
+    // owned nodes, and owned elements, are contiguous blocks in the global
+    //   order, so each process writes its blocks without communication
+    PetscCall(UMXDMFOpenBinary(xdmf,FILE_MODE_WRITE,&viewer));
+    PetscCall(UMGetNodeCoordArrayRead(mesh,&aloc));
+    PetscCall(PetscViewerBinaryWriteAll(viewer,aloc,2*mesh->Nown,
+                                        PETSC_DETERMINE,PETSC_DETERMINE,PETSC_REAL));
+    PetscCall(UMRestoreNodeCoordArrayRead(mesh,&aloc));
+    // element node lists, in global node indices; for P2 the vertices and
+    //   then the edge nodes, which is the XDMF Triangle_6 order
+    PetscCall(PetscMalloc1(xdmf->nen*mesh->Kloc,&eg));
+    PetscCall(ISGetIndices(mesh->e,&ae));
+    for (k = 0; k < mesh->Kloc; k++)
+        for (l = 0; l < 3; l++)
+            eg[xdmf->nen*k+l] = ae[3*k+l];
+    PetscCall(ISRestoreIndices(mesh->e,&ae));
+    if (mesh->em) {
+        PetscCall(ISGetIndices(mesh->em,&aem));
+        for (k = 0; k < mesh->Kloc; k++)
+            for (l = 0; l < 3; l++)
+                eg[6*k+3+l] = aem[3*k+l];
+        PetscCall(ISRestoreIndices(mesh->em,&aem));
+    }
+    PetscCall(ISLocalToGlobalMappingApply(mesh->l2g,xdmf->nen*mesh->Kloc,eg,eg));
+    PetscCall(PetscViewerBinaryWriteAll(viewer,eg,xdmf->nen*mesh->Kloc,
+                                        PETSC_DETERMINE,PETSC_DETERMINE,PETSC_INT));
+    PetscCall(PetscFree(eg));
+    PetscCall(PetscViewerDestroy(&viewer));
+    PetscCall(UMXDMFWriteDescriptor(xdmf));
+    return 0;
+}
+
+PetscErrorCode UMXDMFAppendField(UM *mesh, UMXDMF *xdmf, Vec u,
+                                 const char *name) {
+    PetscInt          Nu, m;
+    const PetscReal   *au;
+    PetscViewer       viewer;
+    PetscCall(VecGetSize(u,&Nu));
+    PetscCall(VecGetLocalSize(u,&m));
+    if (Nu != xdmf->N || m != mesh->Nown) {
+        SETERRQ(PETSC_COMM_SELF,1,
+           "Vec is not node-based for the mesh in %s.xmf\n",xdmf->root);
+    }
+    if (xdmf->nfields == UM_XDMF_MAXFIELDS) {
+        SETERRQ(PETSC_COMM_SELF,2,"at most %d fields in %s.xmf\n",
+                UM_XDMF_MAXFIELDS,xdmf->root);
+    }
+    PetscCall(UMXDMFOpenBinary(xdmf,FILE_MODE_APPEND,&viewer));
+    PetscCall(VecGetArrayRead(u,&au));
+    PetscCall(PetscViewerBinaryWriteAll(viewer,au,m,
+                                        PETSC_DETERMINE,PETSC_DETERMINE,PETSC_REAL));
+    PetscCall(VecRestoreArrayRead(u,&au));
+    PetscCall(PetscViewerDestroy(&viewer));
+    PetscCall(PetscStrncpy(xdmf->fieldname[xdmf->nfields],name,
+                           sizeof(xdmf->fieldname[0])));
+    xdmf->nfields++;
+    PetscCall(UMXDMFWriteDescriptor(xdmf));
+    return 0;
+}
 
 PetscErrorCode UMReadNodes(UM *mesh, char *filename) {
+    PetscMPIInt    size;
     PetscInt       twoN;
     PetscViewer viewer;
     if (mesh->N > 0) {
@@ -106,6 +348,20 @@ PetscErrorCode UMReadNodes(UM *mesh, char *filename) {
         SETERRQ(PETSC_COMM_SELF,2,"node locations loaded from %s are not N pairs\n",filename);
     }
     mesh->N = twoN / 2;
+    mesh->Nown = mesh->N;
+    mesh->Nloc = mesh->N;
+    // until UMDistribute() every process holds all node coordinates
+    PetscCall(MPI_Comm_size(PETSC_COMM_WORLD,&size));
+    if (size > 1) {
+        Vec         locall;
+        VecScatter  toall;
+        PetscCall(VecScatterCreateToAll(mesh->loc,&toall,&locall));
+        PetscCall(VecScatterBegin(toall,mesh->loc,locall,INSERT_VALUES,SCATTER_FORWARD));
+        PetscCall(VecScatterEnd(toall,mesh->loc,locall,INSERT_VALUES,SCATTER_FORWARD));
+        PetscCall(VecScatterDestroy(&toall));
+        PetscCall(VecDestroy(&(mesh->loc)));
+        mesh->loc = locall;
+    }
     return 0;
 }
 
@@ -130,7 +386,7 @@ PetscErrorCode UMCheckElements(UM *mesh) {
                    3*k+m,ae[3*k+m],mesh->N-1);
             }
         }
-        // FIXME: could add check for distinct indices
+        // distinct indices are checked by UMQuality(), which unfem runs at load
     }
     PetscCall(ISRestoreIndices(mesh->e,&ae));
     return 0;
@@ -181,6 +437,21 @@ PetscErrorCode UMCheckBoundaryData(UM *mesh) {
     return 0;
 }
 
+// load an IS, then gather it so that every process holds all of it
+static PetscErrorCode UMLoadISAll(PetscViewer viewer, IS *is) {
+    PetscMPIInt  size;
+    IS           isall;
+    PetscCall(ISCreate(PETSC_COMM_WORLD,is));
+    PetscCall(ISLoad(*is,viewer));
+    PetscCall(MPI_Comm_size(PETSC_COMM_WORLD,&size));
+    if (size > 1) {
+        PetscCall(ISAllGather(*is,&isall));
+        PetscCall(ISDestroy(is));
+        *is = isall;
+    }
+    return 0;
+}
+
 PetscErrorCode UMReadISs(UM *mesh, char *filename) {
     PetscViewer  viewer;
     PetscInt     n_bf;
@@ -194,8 +465,7 @@ PetscErrorCode UMReadISs(UM *mesh, char *filename) {
     }
     PetscCall(PetscViewerBinaryOpen(PETSC_COMM_WORLD,filename,FILE_MODE_READ,&viewer));
     // create and load e
-    PetscCall(ISCreate(PETSC_COMM_WORLD,&(mesh->e)));
-    PetscCall(ISLoad(mesh->e,viewer));
+    PetscCall(UMLoadISAll(viewer,&(mesh->e)));
     PetscCall(ISGetSize(mesh->e,&(mesh->K)));
     if (mesh->K % 3 != 0) {
         SETERRQ(PETSC_COMM_SELF,3,
@@ -203,8 +473,7 @@ PetscErrorCode UMReadISs(UM *mesh, char *filename) {
     }
     mesh->K /= 3;
     // create and load bf
-    PetscCall(ISCreate(PETSC_COMM_WORLD,&(mesh->bf)));
-    PetscCall(ISLoad(mesh->bf,viewer));
+    PetscCall(UMLoadISAll(viewer,&(mesh->bf)));
     PetscCall(ISGetSize(mesh->bf,&n_bf));
     if (n_bf != mesh->N) {
         SETERRQ(PETSC_COMM_SELF,4,
@@ -213,14 +482,15 @@ PetscErrorCode UMReadISs(UM *mesh, char *filename) {
     // FIXME  seems there is no way to tell if file is empty at this point
     // create and load ns last ... may *start with a negative value* in which case set P = 0
     const PetscInt *ans;
-    PetscCall(ISCreate(PETSC_COMM_WORLD,&(mesh->ns)));
-    PetscCall(ISLoad(mesh->ns,viewer));
+    PetscCall(UMLoadISAll(viewer,&(mesh->ns)));
     PetscCall(ISGetIndices(mesh->ns,&ans));
     if (ans[0] < 0) {
-        ISDestroy(&(mesh->ns));
+        PetscCall(ISRestoreIndices(mesh->ns,&ans));
+        PetscCall(ISDestroy(&(mesh->ns)));
         mesh->ns = NULL;
         mesh->P = 0;
     } else {
+        PetscCall(ISRestoreIndices(mesh->ns,&ans));
         PetscCall(ISGetSize(mesh->ns,&(mesh->P)));
         if (mesh->P % 2 != 0) {
             SETERRQ(PETSC_COMM_SELF,4,
@@ -229,6 +499,8 @@ PetscErrorCode UMReadISs(UM *mesh, char *filename) {
         mesh->P /= 2;
     }
     PetscCall(PetscViewerDestroy(&viewer));
+    mesh->Kloc = mesh->K;
+    mesh->Ploc = mesh->P;
 
     // check that mesh is complete now
     PetscCall(UMCheckElements(mesh));
@@ -236,6 +508,1689 @@ PetscErrorCode UMReadISs(UM *mesh, char *filename) {
     return 0;
 }
 
+/* The .um file is written by umfile.py.  It starts with the 8 characters
+"P4PDESUM" and then ten 64-bit integers, namely a format version (=1),
+sizeof(PetscInt), sizeof(PetscReal), N, K, P, and the byte offsets of the
+arrays loc (2N reals), e (3K ints), bf (N ints), and ns (2P ints; offset
+0 if P=0).  Arrays are in native byte order and 8-byte aligned.  The map
+is private, so UMReorder() can permute in place without changing the file. */
+#define UMFILE_MAGIC    "P4PDESUM"
+#define UMFILE_VERSION  1
+
+PetscErrorCode UMReadMeshFile(UM *mesh, char *filename) {
+    int          fd;
+    struct stat  st;
+    char         *map;
+    int64_t      hdr[10], len[4];
+    const size_t hdrsize = 8 + sizeof(hdr);
+    const char   *arrayname[4] = {"loc", "e", "bf", "ns"};
+    int          j;
+
+    if ((mesh->N > 0) || (mesh->loc != NULL) || (mesh->e != NULL)) {
+        SETERRQ(PETSC_COMM_SELF,1,"mesh already read?\n");
+    }
+    fd = open(filename,O_RDONLY);
+    if (fd < 0) {
+        SETERRQ(PETSC_COMM_SELF,2,"unable to open mesh file %s\n",filename);
+    }
+    if ((fstat(fd,&st) != 0) || ((size_t)st.st_size < hdrsize)) {
+        close(fd);
+        SETERRQ(PETSC_COMM_SELF,3,"mesh file %s is too short\n",filename);
+    }
+    map = mmap(NULL,(size_t)st.st_size,PROT_READ | PROT_WRITE,MAP_PRIVATE,fd,0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        SETERRQ(PETSC_COMM_SELF,4,"unable to memory-map mesh file %s\n",filename);
+    }
+    mesh->map = map;
+    mesh->mapsize = (size_t)st.st_size;
+
+    // check header
+    if (strncmp(map,UMFILE_MAGIC,8) != 0) {
+        SETERRQ(PETSC_COMM_SELF,5,"%s is not a .um mesh file\n",filename);
+    }
+    PetscCall(PetscMemcpy(hdr,map+8,sizeof(hdr)));
+    if (hdr[0] != UMFILE_VERSION) {
+        SETERRQ(PETSC_COMM_SELF,6,"mesh file %s has unknown version %d\n",
+                filename,(int)hdr[0]);
+    }
+    if ((hdr[1] != (int64_t)sizeof(PetscInt)) || (hdr[2] != (int64_t)sizeof(PetscReal))) {
+        SETERRQ(PETSC_COMM_SELF,7,
+                "mesh file %s has %d-byte ints and %d-byte reals but PETSc uses %d and %d\n",
+                filename,(int)hdr[1],(int)hdr[2],(int)sizeof(PetscInt),(int)sizeof(PetscReal));
+    }
+    mesh->N = hdr[3];
+    mesh->K = hdr[4];
+    mesh->P = hdr[5];
+    if ((mesh->N <= 0) || (mesh->K <= 0) || (mesh->P < 0)
+        || (hdr[3] > st.st_size) || (hdr[4] > st.st_size) || (hdr[5] > st.st_size)) {
+        SETERRQ(PETSC_COMM_SELF,8,"header of mesh file %s is inconsistent\n",filename);
+    }
+    // each array must start after the header, be 8-byte aligned, and end
+    //   within the file; the ns offset is 0 if P=0
+    len[0] = 2*mesh->N*(int64_t)sizeof(PetscReal);
+    len[1] = 3*mesh->K*(int64_t)sizeof(PetscInt);
+    len[2] = mesh->N*(int64_t)sizeof(PetscInt);
+    len[3] = 2*mesh->P*(int64_t)sizeof(PetscInt);
+    for (j = 0; j < 4; j++) {
+        if ((j == 3) && (mesh->P == 0) && (hdr[9] == 0))
+            continue;
+        if ((hdr[6+j] < (int64_t)hdrsize) || (hdr[6+j] % 8 != 0)
+            || (hdr[6+j] > st.st_size) || (len[j] > st.st_size - hdr[6+j])) {
+            SETERRQ(PETSC_COMM_SELF,8,"header of mesh file %s has bad offset %lld for array %s\n",
+                    filename,(long long)hdr[6+j],arrayname[j]);
+        }
+    }
+
+    // wrap arrays in the map; every process holds the whole mesh
+    PetscCall(VecCreateSeqWithArray(PETSC_COMM_SELF,1,2*mesh->N,
+                                    (PetscReal*)(map + hdr[6]),&(mesh->loc)));
+    PetscCall(ISCreateGeneral(PETSC_COMM_SELF,3*mesh->K,(PetscInt*)(map + hdr[7]),
+                              PETSC_USE_POINTER,&(mesh->e)));
+    PetscCall(ISCreateGeneral(PETSC_COMM_SELF,mesh->N,(PetscInt*)(map + hdr[8]),
+                              PETSC_USE_POINTER,&(mesh->bf)));
+    if (mesh->P > 0) {
+        PetscCall(ISCreateGeneral(PETSC_COMM_SELF,2*mesh->P,(PetscInt*)(map + hdr[9]),
+                                  PETSC_USE_POINTER,&(mesh->ns)));
+    }
+    mesh->Nown = mesh->N;
+    mesh->Nloc = mesh->N;
+    mesh->Kloc = mesh->K;
+    mesh->Ploc = mesh->P;
+
+    PetscCall(UMCheckElements(mesh));
+    PetscCall(UMCheckBoundaryData(mesh));
+    return 0;
+}
+
+
+/* Streaming reader for Gmsh .msh files, formats 2.2 and 4.1, ASCII or
+binary.  See msh2petsc.py and meshes/format22.py, meshes/format41.py for
+the layouts.  Values are read one at a time, so the file is never held in
+memory.  In binary files "int" fields are 4 bytes and, for 4.1, "size_t"
+fields are 8 bytes; byte order comes from the integer one which follows
+the $MeshFormat line. */
+typedef struct {
+    FILE      *f;
+    PetscBool binary,   // binary, not ASCII, data
+              swap;     // binary data in the other byte order
+    PetscInt  version;  // 22 or 41
+    char      line[256];
+    long long *ntag;    // arrays allocated while reading; freed by
+    PetscInt  *ctag,    //     UMGmshFree() on success or error
+              *cphys, *ae, *abf, *ans;
+    PetscReal *aloc;
+} UMGmsh;
+
+static void UMGmshSwap(void *data, size_t size) {
+    unsigned char *b = (unsigned char*)data, t;
+    size_t        i;
+    for (i = 0; i < size / 2; i++) {
+        t = b[i];  b[i] = b[size-1-i];  b[size-1-i] = t;
+    }
+}
+
+// read an "int" (4 bytes if binary) or, if issize, a "size_t" (8 bytes)
+static PetscErrorCode UMGmshReadInt(UMGmsh *g, PetscBool issize, long long *v) {
+    int32_t  i4;
+    int64_t  i8;
+    if (!g->binary) {
+        if (fscanf(g->f,"%lld",v) != 1) {
+            SETERRQ(PETSC_COMM_SELF,1,"error reading integer from Gmsh file\n");
+        }
+    } else if (issize) {
+        if (fread(&i8,8,1,g->f) != 1) {
+            SETERRQ(PETSC_COMM_SELF,1,"error reading integer from Gmsh file\n");
+        }
+        if (g->swap)
+            UMGmshSwap(&i8,8);
+        *v = i8;
+    } else {
+        if (fread(&i4,4,1,g->f) != 1) {
+            SETERRQ(PETSC_COMM_SELF,1,"error reading integer from Gmsh file\n");
+        }
+        if (g->swap)
+            UMGmshSwap(&i4,4);
+        *v = i4;
+    }
+    return 0;
+}
+
+static PetscErrorCode UMGmshReadReal(UMGmsh *g, double *v) {
+    if (!g->binary) {
+        if (fscanf(g->f,"%lf",v) != 1) {
+            SETERRQ(PETSC_COMM_SELF,1,"error reading real from Gmsh file\n");
+        }
+    } else {
+        if (fread(v,8,1,g->f) != 1) {
+            SETERRQ(PETSC_COMM_SELF,1,"error reading real from Gmsh file\n");
+        }
+        if (g->swap)
+            UMGmshSwap(v,8);
+    }
+    return 0;
+}
+
+// next nonempty line, without trailing whitespace, into g->line
+static PetscErrorCode UMGmshNextLine(UMGmsh *g, PetscBool *eof) {
+    size_t  n;
+    *eof = PETSC_FALSE;
+    do {
+        if (fgets(g->line,sizeof(g->line),g->f) == NULL) {
+            *eof = PETSC_TRUE;
+            return 0;
+        }
+        n = strlen(g->line);
+        while ((n > 0) && isspace((unsigned char)g->line[n-1]))
+            g->line[--n] = '\0';
+    } while (n == 0);
+    return 0;
+}
+
+static PetscErrorCode UMGmshExpect(UMGmsh *g, const char *s) {
+    PetscBool  eof;
+    PetscCall(UMGmshNextLine(g,&eof));
+    if (eof || (strcmp(g->line,s) != 0)) {
+        SETERRQ(PETSC_COMM_SELF,2,"expected %s in Gmsh file\n",s);
+    }
+    return 0;
+}
+
+// in binary 2.2 files the counts are on ASCII lines before binary data
+static void UMGmshEndCountLine(UMGmsh *g) {
+    int  c;
+    if (g->binary)
+        do {
+            c = fgetc(g->f);
+        } while ((c != '\n') && (c != EOF));
+}
+
+// read one 4.1 entity of dimension dim; returns its tag and first physical
+//   tag (0 if none)
+static PetscErrorCode UMGmshReadEntity(UMGmsh *g, PetscInt dim,
+                                       long long *tag, long long *phys) {
+    long long  n, j, v;
+    double     x;
+    PetscCall(UMGmshReadInt(g,PETSC_FALSE,tag));
+    for (j = 0; j < ((dim == 0) ? 3 : 6); j++)
+        PetscCall(UMGmshReadReal(g,&x));
+    *phys = 0;
+    PetscCall(UMGmshReadInt(g,PETSC_TRUE,&n));
+    for (j = 0; j < n; j++) {
+        PetscCall(UMGmshReadInt(g,PETSC_FALSE,&v));
+        if (j == 0)
+            *phys = v;
+    }
+    if (dim > 0) {  // bounding entities
+        PetscCall(UMGmshReadInt(g,PETSC_TRUE,&n));
+        for (j = 0; j < n; j++)
+            PetscCall(UMGmshReadInt(g,PETSC_FALSE,&v));
+    }
+    return 0;
+}
+
+// add a triangle, or a boundary segment with flag 2 (Dirichlet) or 1
+//   (Neumann); points, and segments with other flags, are ignored
+static PetscErrorCode UMGmshAddElement(PetscInt type, PetscInt flag,
+                                       const long long *nodes, PetscInt N,
+                                       PetscInt *ae, PetscInt *K,
+                                       PetscInt *abf, PetscInt *ans,
+                                       PetscInt *P) {
+    PetscInt  j, nn = (type == 2) ? 3 : 2;
+    if (type == 15)
+        return 0;
+    for (j = 0; j < nn; j++) {
+        if ((nodes[j] < 1) || (nodes[j] > N)) {
+            SETERRQ(PETSC_COMM_SELF,3,
+                    "node tag %d in Gmsh element invalid: not between 1 and N=%d\n",
+                    (int)nodes[j],N);
+        }
+    }
+    if (type == 2) {
+        for (j = 0; j < 3; j++)
+            ae[3*(*K)+j] = nodes[j] - 1;
+        (*K)++;
+    } else if (flag == 1 || flag == 2) {
+        // Dirichlet wins at nodes shared with Neumann segments
+        for (j = 0; j < 2; j++)
+            abf[nodes[j]-1] = PetscMax(abf[nodes[j]-1],flag);
+        if (flag == 1) {
+            ans[2*(*P)+0] = nodes[0] - 1;
+            ans[2*(*P)+1] = nodes[1] - 1;
+            (*P)++;
+        }
+    }
+    return 0;
+}
+
+// number of nodes for Gmsh element types 1 (segment), 2 (triangle), and
+//   15 (point); others are not supported
+static PetscErrorCode UMGmshElementNodes(long long type, PetscInt *nn) {
+    switch (type) {
+        case 1 :  *nn = 2;  break;
+        case 2 :  *nn = 3;  break;
+        case 15 : *nn = 1;  break;
+        default :
+            SETERRQ(PETSC_COMM_SELF,4,
+                    "Gmsh element type %d not supported; use first-order triangles\n",
+                    (int)type);
+    }
+    return 0;
+}
+
+static PetscErrorCode UMGmshFree(UMGmsh *g) {
+    PetscCall(PetscFree3(g->aloc,g->abf,g->ntag));
+    PetscCall(PetscFree2(g->ae,g->ans));
+    PetscCall(PetscFree2(g->ctag,g->cphys));
+    return 0;
+}
+
+// read sections up to and including $Elements; sets mesh->N, and the
+//   numbers K of triangles and P of Neumann segments
+static PetscErrorCode UMGmshReadSections(UMGmsh *g, UM *mesh, const char *filename,
+                                         PetscInt *K, PetscInt *P) {
+    PetscBool  eof, elementsread = PETSC_FALSE;
+    char       name[64];
+    double     version, xyz[3];
+    long long  ftype, dsize, nb, ne, nent[4], nn, t, tag, phys, mintag, maxtag,
+               dim, type, ntags, nfollow, nodes[3], nread;
+    int        one, c;
+    PetscInt   b, i, j, d, nnode, flag, Ndir = -1, Nneu = -1, Nint = -1,
+               NC = 0;
+
+    while (!elementsread) {
+        PetscCall(UMGmshNextLine(g,&eof));
+        if (eof)
+            break;
+        if (strcmp(g->line,"$MeshFormat") == 0) {
+            if (fscanf(g->f,"%lf %lld %lld",&version,&ftype,&dsize) != 3) {
+                SETERRQ(PETSC_COMM_SELF,3,"unable to read format of Gmsh file %s\n",filename);
+            }
+            g->version = (PetscInt)(10.0 * version + 0.5);
+            if ((g->version != 22) && (g->version != 41)) {
+                SETERRQ(PETSC_COMM_SELF,4,
+                        "Gmsh file %s has format %g; only 2.2 and 4.1 are supported\n",
+                        filename,version);
+            }
+            if (dsize != 8) {
+                SETERRQ(PETSC_COMM_SELF,4,"Gmsh file %s has data size %d; expected 8\n",
+                        filename,(int)dsize);
+            }
+            g->binary = (ftype == 1) ? PETSC_TRUE : PETSC_FALSE;
+            if (g->binary) {
+                do {
+                    c = fgetc(g->f);
+                } while ((c != '\n') && (c != EOF));
+                if (fread(&one,sizeof(int),1,g->f) != 1) {
+                    SETERRQ(PETSC_COMM_SELF,3,"unable to read format of Gmsh file %s\n",filename);
+                }
+                if (one != 1) {
+                    UMGmshSwap(&one,sizeof(int));
+                    if (one != 1) {
+                        SETERRQ(PETSC_COMM_SELF,3,"unknown byte order in Gmsh file %s\n",filename);
+                    }
+                    g->swap = PETSC_TRUE;
+                }
+            }
+            PetscCall(UMGmshExpect(g,"$EndMeshFormat"));
+        } else if (strcmp(g->line,"$PhysicalNames") == 0) {
+            // always ASCII; map names to physical tags
+            if (fscanf(g->f,"%lld",&nb) != 1) {
+                SETERRQ(PETSC_COMM_SELF,5,"unable to read physical names in %s\n",filename);
+            }
+            for (b = 0; b < nb; b++) {
+                if (fscanf(g->f,"%lld %lld \"%63[^\"]\"",&dim,&tag,name) != 3) {
+                    SETERRQ(PETSC_COMM_SELF,5,"unable to read physical names in %s\n",filename);
+                }
+                for (i = 0; name[i]; i++)
+                    name[i] = tolower((unsigned char)name[i]);
+                if (strcmp(name,"dirichlet") == 0)
+                    Ndir = tag;
+                else if (strcmp(name,"neumann") == 0)
+                    Nneu = tag;
+                else if (strcmp(name,"interior") == 0)
+                    Nint = tag;
+            }
+            PetscCall(UMGmshExpect(g,"$EndPhysicalNames"));
+            if ((Ndir < 0) || (Nneu < 0) || (Nint < 0)) {
+                SETERRQ(PETSC_COMM_SELF,5,
+                        "Gmsh file %s needs physical names dirichlet, neumann, and interior\n",
+                        filename);
+            }
+        } else if ((strcmp(g->line,"$Entities") == 0) && (g->version == 41)) {
+            // physical tag of each curve, for the flags of boundary segments
+            if (g->ctag) {
+                SETERRQ(PETSC_COMM_SELF,5,"more than one $Entities section in %s\n",filename);
+            }
+            for (d = 0; d < 4; d++) {
+                PetscCall(UMGmshReadInt(g,PETSC_TRUE,&(nent[d])));
+                if (nent[d] < 0) {
+                    SETERRQ(PETSC_COMM_SELF,5,"negative entity count in %s\n",filename);
+                }
+            }
+            NC = nent[1];
+            PetscCall(PetscMalloc2(NC,&(g->ctag),NC,&(g->cphys)));
+            for (d = 0; d < 4; d++) {
+                for (b = 0; b < nent[d]; b++) {
+                    PetscCall(UMGmshReadEntity(g,d,&tag,&phys));
+                    if (d == 1) {
+                        g->ctag[b] = tag;
+                        g->cphys[b] = phys;
+                    }
+                }
+            }
+            PetscCall(UMGmshExpect(g,"$EndEntities"));
+        } else if (strcmp(g->line,"$Nodes") == 0) {
+            if (g->version == 0) {
+                SETERRQ(PETSC_COMM_SELF,3,"no $MeshFormat before $Nodes in %s\n",filename);
+            }
+            if (g->aloc) {
+                SETERRQ(PETSC_COMM_SELF,6,"more than one $Nodes section in %s\n",filename);
+            }
+            if (g->version == 41) {
+                PetscCall(UMGmshReadInt(g,PETSC_TRUE,&nb));
+                PetscCall(UMGmshReadInt(g,PETSC_TRUE,&nn));
+                PetscCall(UMGmshReadInt(g,PETSC_TRUE,&mintag));
+                PetscCall(UMGmshReadInt(g,PETSC_TRUE,&maxtag));
+            } else {
+                nb = 1;
+                if (fscanf(g->f,"%lld",&nn) != 1) {
+                    SETERRQ(PETSC_COMM_SELF,6,"unable to read nodes in %s\n",filename);
+                }
+                UMGmshEndCountLine(g);
+                mintag = 1;
+                maxtag = nn;
+            }
+            // node tags must be 1,...,N, as in msh2petsc.py
+            if ((nn <= 0) || (mintag != 1) || (maxtag != nn)) {
+                SETERRQ(PETSC_COMM_SELF,6,"node tags in %s are not 1,...,N\n",filename);
+            }
+            mesh->N = nn;
+            PetscCall(PetscMalloc3(2*mesh->N,&(g->aloc),mesh->N,&(g->abf),mesh->N,&(g->ntag)));
+            for (i = 0; i < mesh->N; i++)
+                g->abf[i] = 0;
+            j = 0;  // count of nodes read
+            for (b = 0; b < nb; b++) {
+                if (g->version == 41) {
+                    PetscCall(UMGmshReadInt(g,PETSC_FALSE,&dim));
+                    PetscCall(UMGmshReadInt(g,PETSC_FALSE,&tag));
+                    PetscCall(UMGmshReadInt(g,PETSC_FALSE,&phys));  // parametric
+                    PetscCall(UMGmshReadInt(g,PETSC_TRUE,&ne));
+                    if (phys != 0) {
+                        SETERRQ(PETSC_COMM_SELF,6,"parametric nodes in %s not supported\n",filename);
+                    }
+                } else
+                    ne = nn;
+                // check before the tags of the block are stored
+                if ((ne < 0) || (j + ne > mesh->N)) {
+                    SETERRQ(PETSC_COMM_SELF,6,"too many nodes in %s\n",filename);
+                }
+                if (g->version == 41)
+                    for (i = 0; i < ne; i++)
+                        PetscCall(UMGmshReadInt(g,PETSC_TRUE,&(g->ntag[i])));
+                for (i = 0; i < ne; i++) {
+                    if (g->version == 22)
+                        PetscCall(UMGmshReadInt(g,PETSC_FALSE,&(g->ntag[i])));
+                    for (d = 0; d < 3; d++)
+                        PetscCall(UMGmshReadReal(g,&(xyz[d])));
+                    if ((g->ntag[i] < 1) || (g->ntag[i] > mesh->N)) {
+                        SETERRQ(PETSC_COMM_SELF,6,"node tags in %s are not 1,...,N\n",filename);
+                    }
+                    g->aloc[2*(g->ntag[i]-1)+0] = xyz[0];  // ignore z
+                    g->aloc[2*(g->ntag[i]-1)+1] = xyz[1];
+                }
+                j += ne;
+            }
+            PetscCall(UMGmshExpect(g,"$EndNodes"));
+        } else if (strcmp(g->line,"$Elements") == 0) {
+            if ((g->aloc == NULL) || ((g->version == 41) && (g->ctag == NULL)) || (Nint < 0)) {
+                SETERRQ(PETSC_COMM_SELF,7,
+                        "$Elements before $PhysicalNames, $Entities, or $Nodes in %s\n",filename);
+            }
+            if (g->version == 41) {
+                PetscCall(UMGmshReadInt(g,PETSC_TRUE,&nb));
+                PetscCall(UMGmshReadInt(g,PETSC_TRUE,&ne));
+                PetscCall(UMGmshReadInt(g,PETSC_TRUE,&mintag));
+                PetscCall(UMGmshReadInt(g,PETSC_TRUE,&maxtag));
+            } else {
+                if (fscanf(g->f,"%lld",&ne) != 1) {
+                    SETERRQ(PETSC_COMM_SELF,7,"unable to read elements in %s\n",filename);
+                }
+                UMGmshEndCountLine(g);
+            }
+            if (ne < 0) {
+                SETERRQ(PETSC_COMM_SELF,7,"negative element count in %s\n",filename);
+            }
+            // ne counts triangles and segments, so bounds both lists, as long
+            //   as no more than ne elements are read
+            PetscCall(PetscMalloc2(3*ne,&(g->ae),2*ne,&(g->ans)));
+            nread = 0;
+            if (g->version == 41) {
+                for (b = 0; b < nb; b++) {
+                    PetscCall(UMGmshReadInt(g,PETSC_FALSE,&dim));
+                    PetscCall(UMGmshReadInt(g,PETSC_FALSE,&tag));
+                    PetscCall(UMGmshReadInt(g,PETSC_FALSE,&type));
+                    PetscCall(UMGmshReadInt(g,PETSC_TRUE,&nfollow));
+                    if ((nfollow < 0) || (nread + nfollow > ne)) {
+                        SETERRQ(PETSC_COMM_SELF,7,"too many elements in %s\n",filename);
+                    }
+                    nread += nfollow;
+                    PetscCall(UMGmshElementNodes(type,&nnode));
+                    flag = 0;
+                    if (dim == 1) {
+                        for (i = 0; i < NC; i++)
+                            if (g->ctag[i] == tag) {
+                                flag = (g->cphys[i] == Ndir) ? 2 : ((g->cphys[i] == Nneu) ? 1 : 0);
+                                break;
+                            }
+                    }
+                    for (j = 0; j < nfollow; j++) {
+                        PetscCall(UMGmshReadInt(g,PETSC_TRUE,&t));  // element tag
+                        for (i = 0; i < nnode; i++)
+                            PetscCall(UMGmshReadInt(g,PETSC_TRUE,&(nodes[i])));
+                        PetscCall(UMGmshAddElement(type,flag,nodes,mesh->N,
+                                                   g->ae,K,g->abf,g->ans,P));
+                    }
+                }
+            } else {
+                // ASCII lines are  number type ntags tag ... node ...;
+                //   binary has headers  type nfollow ntags  for runs of
+                //   records  number tag ... node ...
+                for (j = 0; j < ne; ) {
+                    nfollow = 1;
+                    if (g->binary) {
+                        PetscCall(UMGmshReadInt(g,PETSC_FALSE,&type));
+                        PetscCall(UMGmshReadInt(g,PETSC_FALSE,&nfollow));
+                        PetscCall(UMGmshReadInt(g,PETSC_FALSE,&ntags));
+                        if ((nfollow < 0) || (j + nfollow > ne)) {
+                            SETERRQ(PETSC_COMM_SELF,7,"too many elements in %s\n",filename);
+                        }
+                    }
+                    for (b = 0; b < nfollow; b++, j++) {
+                        PetscCall(UMGmshReadInt(g,PETSC_FALSE,&t));  // element number
+                        if (!g->binary) {
+                            PetscCall(UMGmshReadInt(g,PETSC_FALSE,&type));
+                            PetscCall(UMGmshReadInt(g,PETSC_FALSE,&ntags));
+                        }
+                        phys = 0;
+                        for (i = 0; i < ntags; i++) {
+                            PetscCall(UMGmshReadInt(g,PETSC_FALSE,&t));
+                            if (i == 0)
+                                phys = t;
+                        }
+                        PetscCall(UMGmshElementNodes(type,&nnode));
+                        for (i = 0; i < nnode; i++)
+                            PetscCall(UMGmshReadInt(g,PETSC_FALSE,&(nodes[i])));
+                        flag = (phys == Ndir) ? 2 : ((phys == Nneu) ? 1 : 0);
+                        PetscCall(UMGmshAddElement(type,flag,nodes,mesh->N,
+                                                   g->ae,K,g->abf,g->ans,P));
+                    }
+                }
+            }
+            PetscCall(UMGmshExpect(g,"$EndElements"));
+            elementsread = PETSC_TRUE;
+        } else if (g->line[0] == '$') {
+            // skip other sections, such as $Periodic or $NodeData
+            PetscCall(PetscSNPrintf(name,sizeof(name),"$End%s",g->line+1));
+            do {
+                PetscCall(UMGmshNextLine(g,&eof));
+            } while (!eof && (strcmp(g->line,name) != 0));
+        }
+    }
+    if (!elementsread || (*K == 0)) {
+        SETERRQ(PETSC_COMM_SELF,8,"no triangles read from Gmsh file %s\n",filename);
+    }
+    return 0;
+}
+
+PetscErrorCode UMReadGmsh(UM *mesh, char *filename) {
+    UMGmsh          g;
+    PetscErrorCode  ierr;
+    PetscInt        K = 0, P = 0;
+
+    if ((mesh->N > 0) || (mesh->loc != NULL) || (mesh->e != NULL)) {
+        SETERRQ(PETSC_COMM_SELF,1,"mesh already read?\n");
+    }
+    g.f = fopen(filename,"rb");
+    if (g.f == NULL) {
+        SETERRQ(PETSC_COMM_SELF,2,"unable to open Gmsh file %s\n",filename);
+    }
+    g.binary = PETSC_FALSE;
+    g.swap = PETSC_FALSE;
+    g.version = 0;
+    g.ntag = NULL;
+    g.ctag = NULL;
+    g.cphys = NULL;
+    g.ae = NULL;
+    g.abf = NULL;
+    g.ans = NULL;
+    g.aloc = NULL;
+    // every process reads the whole file, as with UMReadMeshFile(); on
+    //   error close it and free the arrays before passing the error on
+    ierr = UMGmshReadSections(&g,mesh,filename,&K,&P);
+    fclose(g.f);
+    if (ierr) {
+        mesh->N = 0;
+        PetscCall(UMGmshFree(&g));
+        PetscCall(ierr);
+    }
+
+    // every process holds the whole mesh
+    mesh->K = K;
+    mesh->P = P;
+    PetscCall(VecCreateSeq(PETSC_COMM_SELF,2*mesh->N,&(mesh->loc)));
+    {
+        PetscReal *aall;
+        PetscCall(VecGetArray(mesh->loc,&aall));
+        PetscCall(PetscArraycpy(aall,g.aloc,2*mesh->N));
+        PetscCall(VecRestoreArray(mesh->loc,&aall));
+    }
+    PetscCall(ISCreateGeneral(PETSC_COMM_SELF,3*K,g.ae,PETSC_COPY_VALUES,&(mesh->e)));
+    PetscCall(ISCreateGeneral(PETSC_COMM_SELF,mesh->N,g.abf,PETSC_COPY_VALUES,&(mesh->bf)));
+    if (P > 0) {
+        PetscCall(ISCreateGeneral(PETSC_COMM_SELF,2*P,g.ans,PETSC_COPY_VALUES,&(mesh->ns)));
+    }
+    PetscCall(UMGmshFree(&g));
+    mesh->Nown = mesh->N;
+    mesh->Nloc = mesh->N;
+    mesh->Kloc = mesh->K;
+    mesh->Ploc = mesh->P;
+
+    PetscCall(UMCheckElements(mesh));
+    PetscCall(UMCheckBoundaryData(mesh));
+    return 0;
+}
+
+
+/* Open-addressing hash table of the edges of a mesh, keyed by node pair
+(a,b) with a < b.  The value of an edge is its index in insertion order.
+At most half of the slots are used, so linear probing is short. */
+typedef struct {
+    PetscInt  mask,  // number of slots minus one; slots are a power of two
+              *key,  // key[2*h+0],key[2*h+1] = a,b in slot h; a = -1 if empty
+              *val,  // val[h] = edge index in slot h
+              n;     // number of edges inserted
+} UMEdgeHash;
+
+static PetscErrorCode UMEdgeHashCreate(PetscInt maxedges, UMEdgeHash *eh) {
+    PetscInt  size = 16, h;
+    while (size < 2 * maxedges)
+        size *= 2;
+    eh->mask = size - 1;
+    eh->n = 0;
+    PetscCall(PetscMalloc2(2*size,&(eh->key),size,&(eh->val)));
+    for (h = 0; h < size; h++)
+        eh->key[2*h] = -1;
+    return 0;
+}
+
+static PetscErrorCode UMEdgeHashDestroy(UMEdgeHash *eh) {
+    PetscCall(PetscFree2(eh->key,eh->val));
+    return 0;
+}
+
+// return index of edge {a,b}; if absent, insert it when insert is true and
+//   otherwise return -1; *isnew reports an insertion
+static PetscInt UMEdgeHashLookup(UMEdgeHash *eh, PetscInt a, PetscInt b,
+                                 PetscBool insert, PetscBool *isnew) {
+    PetscInt  h, tmp;
+    if (a > b) {
+        tmp = a;  a = b;  b = tmp;
+    }
+    h = (PetscInt)(((uint64_t)a * 0x9E3779B97F4A7C15ULL
+                    ^ (uint64_t)b * 0xC2B2AE3D27D4EB4FULL) >> 17) & eh->mask;
+    if (isnew)
+        *isnew = PETSC_FALSE;
+    while (eh->key[2*h] >= 0) {
+        if ((eh->key[2*h] == a) && (eh->key[2*h+1] == b))
+            return eh->val[h];
+        h = (h + 1) & eh->mask;
+    }
+    if (!insert)
+        return -1;
+    eh->key[2*h+0] = a;
+    eh->key[2*h+1] = b;
+    eh->val[h] = eh->n++;
+    if (isnew)
+        *isnew = PETSC_TRUE;
+    return eh->val[h];
+}
+
+/* Find the edges of the whole mesh and create a node at the midpoint of
+each.  Midpoint node of edge j is N+j, and on return em[3*k+l] is the
+midpoint node of the edge from local node l to local node l+1 (mod 3) of
+element k, nsm[p] is that of Neumann segment p, and mp[2*j],mp[2*j+1] are
+the ends of edge j.  The new coordinates and boundary flags, of length
+N+NE, are in *newloc and *newbf.  A midpoint is flagged 1 on a Neumann
+segment, 2 on any other edge which is in one element and joins boundary
+nodes, and 0 otherwise.  The caller frees em, mp, nsm. */
+static PetscErrorCode UMEdgeMidpoints(UM *mesh, PetscInt *NE, PetscInt **em,
+                                      PetscInt **mp, PetscInt **nsm,
+                                      Vec *newloc, PetscInt **newbf) {
+    const PetscInt  N = mesh->N, *ae, *abf, *ans;
+    const PetscReal *aoldloc;
+    PetscInt        *ecount, k, l, j, p, a, b;
+    PetscReal       *aloc;
+    PetscBool       isnew;
+    UMEdgeHash      eh;
+
+    PetscCall(UMEdgeHashCreate(3*mesh->K,&eh));
+    PetscCall(PetscMalloc1(3*mesh->K,em));
+    PetscCall(PetscMalloc1(6*mesh->K,mp));   // at most 3K edges
+    PetscCall(PetscCalloc1(3*mesh->K,&ecount));
+    PetscCall(ISGetIndices(mesh->e,&ae));
+    for (k = 0; k < mesh->K; k++) {
+        for (l = 0; l < 3; l++) {
+            a = ae[3*k+l];
+            b = ae[3*k+(l+1)%3];
+            j = UMEdgeHashLookup(&eh,a,b,PETSC_TRUE,&isnew);
+            if (isnew) {
+                (*mp)[2*j+0] = a;
+                (*mp)[2*j+1] = b;
+            }
+            (*em)[3*k+l] = N + j;
+            ecount[j]++;
+        }
+    }
+    PetscCall(ISRestoreIndices(mesh->e,&ae));
+    *NE = eh.n;
+
+    // coordinates of old nodes then midpoints
+    PetscCall(VecCreateSeq(PETSC_COMM_SELF,2*(N+*NE),newloc));
+    PetscCall(VecGetArrayRead(mesh->loc,&aoldloc));
+    PetscCall(VecGetArray(*newloc,&aloc));
+    PetscCall(PetscMemcpy(aloc,aoldloc,2*N*sizeof(PetscReal)));
+    for (j = 0; j < *NE; j++) {
+        a = (*mp)[2*j+0];
+        b = (*mp)[2*j+1];
+        aloc[2*(N+j)+0] = 0.5 * (aoldloc[2*a+0] + aoldloc[2*b+0]);
+        aloc[2*(N+j)+1] = 0.5 * (aoldloc[2*a+1] + aoldloc[2*b+1]);
+    }
+    PetscCall(VecRestoreArray(*newloc,&aloc));
+    PetscCall(VecRestoreArrayRead(mesh->loc,&aoldloc));
+
+    // boundary flags: an edge in one element, between boundary nodes, is on
+    //   the boundary and Dirichlet unless it is a Neumann segment
+    PetscCall(PetscMalloc1(N+*NE,newbf));
+    PetscCall(ISGetIndices(mesh->bf,&abf));
+    PetscCall(PetscMemcpy(*newbf,abf,N*sizeof(PetscInt)));
+    for (j = 0; j < *NE; j++)
+        (*newbf)[N+j] = ((ecount[j] == 1) && (abf[(*mp)[2*j]] > 0)
+                         && (abf[(*mp)[2*j+1]] > 0)) ? 2 : 0;
+    PetscCall(ISRestoreIndices(mesh->bf,&abf));
+    PetscCall(PetscFree(ecount));
+
+    *nsm = NULL;
+    if (mesh->P > 0) {
+        PetscCall(PetscMalloc1(mesh->P,nsm));
+        PetscCall(ISGetIndices(mesh->ns,&ans));
+        for (p = 0; p < mesh->P; p++) {
+            a = ans[2*p+0];
+            b = ans[2*p+1];
+            j = UMEdgeHashLookup(&eh,a,b,PETSC_FALSE,NULL);
+            if (j < 0) {
+                SETERRQ(PETSC_COMM_SELF,3,
+                        "Neumann segment %d = (%d,%d) is not an element edge\n",p,a,b);
+            }
+            (*newbf)[N+j] = 1;
+            (*nsm)[p] = N + j;
+        }
+        PetscCall(ISRestoreIndices(mesh->ns,&ans));
+    }
+    PetscCall(UMEdgeHashDestroy(&eh));
+    return 0;
+}
+
+// replace loc and bf by new versions of length Nnew
+static PetscErrorCode UMReplaceNodes(UM *mesh, PetscInt Nnew, Vec newloc,
+                                     PetscInt *newbf) {
+    PetscCall(VecDestroy(&(mesh->loc)));
+    PetscCall(ISDestroy(&(mesh->bf)));
+    mesh->loc = newloc;
+    PetscCall(ISCreateGeneral(PETSC_COMM_SELF,Nnew,newbf,PETSC_OWN_POINTER,&(mesh->bf)));
+    mesh->N = Nnew;
+    mesh->Nown = Nnew;
+    mesh->Nloc = Nnew;
+    return 0;
+}
+
+PetscErrorCode UMRefineUniform(UM *mesh, IS *midparents) {
+    const PetscInt  *ae, *ans;
+    PetscInt        *em, *mp, *nsm, *newe, *newbf, *newns = NULL,
+                    NE, k, p;
+    Vec             newloc;
+
+    if ((mesh->N == 0) || (mesh->K == 0) || (mesh->e == NULL) || (mesh->bf == NULL)) {
+        SETERRQ(PETSC_COMM_SELF,1,
+                "mesh not complete; call UMReadNodes() and UMReadISs() first\n");
+    }
+    if (mesh->l2g || mesh->perm || mesh->geom || mesh->em) {
+        SETERRQ(PETSC_COMM_SELF,2,
+                "mesh already distributed, reordered, or given edge nodes; call UMRefineUniform() first\n");
+    }
+    PetscCall(UMEdgeMidpoints(mesh,&NE,&em,&mp,&nsm,&newloc,&newbf));
+
+    // children of element (a,b,c) with midpoints mab,mbc,mca are (a,mab,mca),
+    //   (mab,b,mbc), (mca,mbc,c), and (mab,mbc,mca); all keep the orientation
+    PetscCall(PetscMalloc1(12*mesh->K,&newe));
+    PetscCall(ISGetIndices(mesh->e,&ae));
+    for (k = 0; k < mesh->K; k++) {
+        const PetscInt *v = ae + 3*k,
+                       m0 = em[3*k+0], m1 = em[3*k+1], m2 = em[3*k+2];
+        PetscInt       *c = newe + 12*k;
+        c[0] = v[0];  c[1]  = m0;    c[2]  = m2;
+        c[3] = m0;    c[4]  = v[1];  c[5]  = m1;
+        c[6] = m2;    c[7]  = m1;    c[8]  = v[2];
+        c[9] = m0;    c[10] = m1;    c[11] = m2;
+    }
+    PetscCall(ISRestoreIndices(mesh->e,&ae));
+    PetscCall(PetscFree(em));
+
+    // split Neumann segments (a,b) into (a,m),(m,b)
+    if (mesh->P > 0) {
+        PetscCall(PetscMalloc1(4*mesh->P,&newns));
+        PetscCall(ISGetIndices(mesh->ns,&ans));
+        for (p = 0; p < mesh->P; p++) {
+            newns[4*p+0] = ans[2*p+0];
+            newns[4*p+1] = nsm[p];
+            newns[4*p+2] = nsm[p];
+            newns[4*p+3] = ans[2*p+1];
+        }
+        PetscCall(ISRestoreIndices(mesh->ns,&ans));
+        PetscCall(PetscFree(nsm));
+    }
+
+    // replace mesh arrays
+    PetscCall(ISDestroy(&(mesh->e)));
+    PetscCall(ISDestroy(&(mesh->ns)));
+    PetscCall(ISCreateGeneral(PETSC_COMM_SELF,12*mesh->K,newe,PETSC_OWN_POINTER,&(mesh->e)));
+    if (mesh->P > 0) {
+        PetscCall(ISCreateGeneral(PETSC_COMM_SELF,4*mesh->P,newns,PETSC_OWN_POINTER,&(mesh->ns)));
+    }
+    PetscCall(UMReplaceNodes(mesh,mesh->N+NE,newloc,newbf));
+    if (mesh->map) {
+        munmap(mesh->map,mesh->mapsize);
+        mesh->map = NULL;
+        mesh->mapsize = 0;
+    }
+    if (midparents) {
+        PetscCall(ISCreateGeneral(PETSC_COMM_SELF,2*NE,mp,PETSC_OWN_POINTER,midparents));
+    } else {
+        PetscCall(PetscFree(mp));
+    }
+    mesh->K *= 4;
+    mesh->P *= 2;
+    mesh->Kloc = mesh->K;
+    mesh->Ploc = mesh->P;
+    return 0;
+}
+
+// rotate the nodes of element v so that its longest edge is from v[0] to
+//   v[1]; a rotation keeps the orientation
+static void UMLabelLongestEdge(const PetscReal *aloc, PetscInt v[3]) {
+    PetscInt   l, lmax = 0, w[3];
+    PetscReal  dx, dy, len, lenmax = -1.0;
+    for (l = 0; l < 3; l++) {
+        dx = aloc[2*v[(l+1)%3]+0] - aloc[2*v[l]+0];
+        dy = aloc[2*v[(l+1)%3]+1] - aloc[2*v[l]+1];
+        len = dx * dx + dy * dy;
+        if (len > lenmax) {
+            lenmax = len;
+            lmax = l;
+        }
+    }
+    for (l = 0; l < 3; l++)
+        w[l] = v[(lmax+l)%3];
+    for (l = 0; l < 3; l++)
+        v[l] = w[l];
+}
+
+// append element (a,b,c), with refinement edge a-b, to newe; if m >= 0 it
+//   is the midpoint of a-b and the element is bisected into (c,a,m) and
+//   (b,c,m), whose newest vertex is m
+static void UMAddBisected(PetscInt a, PetscInt b, PetscInt c, PetscInt m,
+                          PetscInt *newe, PetscInt *Knew) {
+    PetscInt  *t = newe + 3 * (*Knew);
+    if (m < 0) {
+        t[0] = a;  t[1] = b;  t[2] = c;
+        *Knew += 1;
+    } else {
+        t[0] = c;  t[1] = a;  t[2] = m;
+        t[3] = b;  t[4] = c;  t[5] = m;
+        *Knew += 2;
+    }
+}
+
+/* Newest-vertex bisection with edge marking.  The refinement edges of the
+marked elements are marked, and then, until nothing changes, the refinement
+edge of any element with a marked edge; this closure keeps the mesh
+conforming.  An element with a marked refinement edge is bisected into two
+children, whose refinement edges are the other two edges of the parent, and
+each child is bisected again if its refinement edge is marked. */
+PetscErrorCode UMRefineMarked(UM *mesh, const PetscBool *marked, IS *midparents) {
+    const PetscInt  N = mesh->N, K = mesh->K, *ae, *abf, *ans;
+    const PetscReal *aoldloc;
+    PetscInt        *ev, *eedge, *ecount, *mid, *mp, *newe, *newbf,
+                    *newns = NULL, k, l, j, p, a, b, NE, Nmid = 0, Knew = 0,
+                    Pnew = 0;
+    PetscReal       *aloc;
+    PetscBool       *emark, isnew, changed;
+    PetscMPIInt     size;
+    UMEdgeHash      eh;
+    Vec             newloc;
+
+    if ((mesh->N == 0) || (mesh->K == 0) || (mesh->e == NULL) || (mesh->bf == NULL)) {
+        SETERRQ(PETSC_COMM_SELF,1,
+                "mesh not complete; call UMReadNodes() and UMReadISs() first\n");
+    }
+    PetscCall(MPI_Comm_size(PETSC_COMM_WORLD,&size));
+    if ((size > 1) || mesh->perm || mesh->em) {
+        SETERRQ(PETSC_COMM_SELF,2,
+                "UMRefineMarked() is for one process, before UMReorder() and UMAddEdgeNodes()\n");
+    }
+    // on one process UMDistribute() only added l2g and the scatter; these,
+    //   and the geometry and coloring, are for the old mesh
+    PetscCall(ISLocalToGlobalMappingDestroy(&(mesh->l2g)));
+    PetscCall(VecScatterDestroy(&(mesh->ghostscatter)));
+    if (mesh->geom) {
+        PetscCall(PetscFree5(mesh->geom->absdetJ,mesh->geom->gx,mesh->geom->gy,
+                             mesh->geom->xq,mesh->geom->yq));
+        PetscCall(PetscFree(mesh->geom));
+    }
+    PetscCall(PetscFree2(mesh->colorptr,mesh->colorelems));
+    mesh->ncolors = 0;
+
+    // labeled elements and their edges
+    PetscCall(PetscMalloc2(3*K,&ev,3*K,&eedge));
+    PetscCall(ISGetIndices(mesh->e,&ae));
+    PetscCall(PetscMemcpy(ev,ae,3*K*sizeof(PetscInt)));
+    PetscCall(ISRestoreIndices(mesh->e,&ae));
+    PetscCall(VecGetArrayRead(mesh->loc,&aoldloc));
+    if (!mesh->nvb) {
+        for (k = 0; k < K; k++)
+            UMLabelLongestEdge(aoldloc,ev+3*k);
+    }
+    PetscCall(UMEdgeHashCreate(3*K,&eh));
+    PetscCall(PetscMalloc1(6*K,&mp));   // at most 3K edges
+    PetscCall(PetscCalloc1(3*K,&ecount));
+    for (k = 0; k < K; k++) {
+        for (l = 0; l < 3; l++) {
+            a = ev[3*k+l];
+            b = ev[3*k+(l+1)%3];
+            j = UMEdgeHashLookup(&eh,a,b,PETSC_TRUE,&isnew);
+            if (isnew) {
+                mp[2*j+0] = a;
+                mp[2*j+1] = b;
+            }
+            eedge[3*k+l] = j;
+            ecount[j]++;
+        }
+    }
+    NE = eh.n;
+
+    // mark, then close
+    PetscCall(PetscCalloc1(NE,&emark));
+    for (k = 0; k < K; k++)
+        if (marked[k])
+            emark[eedge[3*k]] = PETSC_TRUE;
+    do {
+        changed = PETSC_FALSE;
+        for (k = 0; k < K; k++) {
+            if (!emark[eedge[3*k]] && (emark[eedge[3*k+1]] || emark[eedge[3*k+2]])) {
+                emark[eedge[3*k]] = PETSC_TRUE;
+                changed = PETSC_TRUE;
+            }
+        }
+    } while (changed);
+
+    // midpoints of marked edges are numbered after the old nodes, with
+    //   boundary flags as in UMEdgeMidpoints(); mp is compacted in place
+    PetscCall(PetscMalloc1(NE,&mid));
+    PetscCall(PetscMalloc1(N+NE,&newbf));
+    PetscCall(ISGetIndices(mesh->bf,&abf));
+    PetscCall(PetscMemcpy(newbf,abf,N*sizeof(PetscInt)));
+    for (j = 0; j < NE; j++) {
+        if (!emark[j]) {
+            mid[j] = -1;
+            continue;
+        }
+        a = mp[2*j+0];
+        b = mp[2*j+1];
+        mid[j] = N + Nmid;
+        newbf[N+Nmid] = ((ecount[j] == 1) && (abf[a] > 0) && (abf[b] > 0)) ? 2 : 0;
+        mp[2*Nmid+0] = a;
+        mp[2*Nmid+1] = b;
+        Nmid++;
+    }
+    PetscCall(ISRestoreIndices(mesh->bf,&abf));
+    PetscCall(VecCreateSeq(PETSC_COMM_SELF,2*(N+Nmid),&newloc));
+    PetscCall(VecGetArray(newloc,&aloc));
+    PetscCall(PetscMemcpy(aloc,aoldloc,2*N*sizeof(PetscReal)));
+    for (j = 0; j < Nmid; j++) {
+        a = mp[2*j+0];
+        b = mp[2*j+1];
+        aloc[2*(N+j)+0] = 0.5 * (aoldloc[2*a+0] + aoldloc[2*b+0]);
+        aloc[2*(N+j)+1] = 0.5 * (aoldloc[2*a+1] + aoldloc[2*b+1]);
+    }
+    PetscCall(VecRestoreArray(newloc,&aloc));
+    PetscCall(VecRestoreArrayRead(mesh->loc,&aoldloc));
+
+    // split refined Neumann segments (a,b) into (a,m),(m,b)
+    if (mesh->P > 0) {
+        PetscCall(PetscMalloc1(4*mesh->P,&newns));
+        PetscCall(ISGetIndices(mesh->ns,&ans));
+        for (p = 0; p < mesh->P; p++) {
+            a = ans[2*p+0];
+            b = ans[2*p+1];
+            j = UMEdgeHashLookup(&eh,a,b,PETSC_FALSE,NULL);
+            if (j < 0) {
+                SETERRQ(PETSC_COMM_SELF,3,
+                        "Neumann segment %d = (%d,%d) is not an element edge\n",p,a,b);
+            }
+            newns[2*Pnew+0] = a;
+            if (mid[j] >= 0) {
+                newbf[mid[j]] = 1;
+                newns[2*Pnew+1] = mid[j];
+                newns[2*Pnew+2] = mid[j];
+                Pnew++;
+            }
+            newns[2*Pnew+1] = b;
+            Pnew++;
+        }
+        PetscCall(ISRestoreIndices(mesh->ns,&ans));
+    }
+    PetscCall(UMEdgeHashDestroy(&eh));
+
+    // element (v0,v1,v2) with marked refinement edge v0-v1 has children
+    //   (v2,v0,m) and (v1,v2,m); at most four elements come from each
+    PetscCall(PetscMalloc1(12*K,&newe));
+    for (k = 0; k < K; k++) {
+        const PetscInt *v = ev + 3*k;
+        if (mid[eedge[3*k]] < 0) {
+            UMAddBisected(v[0],v[1],v[2],-1,newe,&Knew);
+        } else {
+            UMAddBisected(v[2],v[0],mid[eedge[3*k]],mid[eedge[3*k+2]],newe,&Knew);
+            UMAddBisected(v[1],v[2],mid[eedge[3*k]],mid[eedge[3*k+1]],newe,&Knew);
+        }
+    }
+    PetscCall(PetscFree2(ev,eedge));
+    PetscCall(PetscFree(ecount));
+    PetscCall(PetscFree(emark));
+    PetscCall(PetscFree(mid));
+
+    // replace mesh arrays
+    PetscCall(ISDestroy(&(mesh->e)));
+    PetscCall(ISDestroy(&(mesh->ns)));
+    PetscCall(ISCreateGeneral(PETSC_COMM_SELF,3*Knew,newe,PETSC_OWN_POINTER,&(mesh->e)));
+    if (mesh->P > 0) {
+        PetscCall(ISCreateGeneral(PETSC_COMM_SELF,2*Pnew,newns,PETSC_OWN_POINTER,&(mesh->ns)));
+    }
+    PetscCall(UMReplaceNodes(mesh,N+Nmid,newloc,newbf));
+    if (mesh->map) {
+        munmap(mesh->map,mesh->mapsize);
+        mesh->map = NULL;
+        mesh->mapsize = 0;
+    }
+    if (midparents) {
+        PetscCall(ISCreateGeneral(PETSC_COMM_SELF,2*Nmid,mp,PETSC_OWN_POINTER,midparents));
+    } else {
+        PetscCall(PetscFree(mp));
+    }
+    mesh->K = Knew;
+    mesh->P = Pnew;
+    mesh->Kloc = Knew;
+    mesh->Ploc = Pnew;
+    mesh->nvb = PETSC_TRUE;
+    return 0;
+}
+
+PetscErrorCode UMAddEdgeNodes(UM *mesh) {
+    PetscInt  *em, *mp, *nsm, *newbf, NE;
+    Vec       newloc;
+
+    if ((mesh->N == 0) || (mesh->K == 0) || (mesh->e == NULL) || (mesh->bf == NULL)) {
+        SETERRQ(PETSC_COMM_SELF,1,
+                "mesh not complete; call UMReadNodes() and UMReadISs() first\n");
+    }
+    if (mesh->l2g || mesh->geom || mesh->em) {
+        SETERRQ(PETSC_COMM_SELF,2,
+                "mesh already distributed or given edge nodes; call UMAddEdgeNodes() before UMDistribute()\n");
+    }
+    PetscCall(UMEdgeMidpoints(mesh,&NE,&em,&mp,&nsm,&newloc,&newbf));
+    PetscCall(PetscFree(mp));
+    PetscCall(ISCreateGeneral(PETSC_COMM_SELF,3*mesh->K,em,PETSC_OWN_POINTER,&(mesh->em)));
+    if (mesh->P > 0) {
+        PetscCall(ISCreateGeneral(PETSC_COMM_SELF,mesh->P,nsm,PETSC_OWN_POINTER,&(mesh->nsm)));
+    }
+    PetscCall(UMReplaceNodes(mesh,mesh->N+NE,newloc,newbf));
+    mesh->Nedge = NE;
+    // e and ns may still point into the map from UMReadMeshFile(), so it is
+    //   left to UMDistribute() or UMDestroy() to unmap it
+    return 0;
+}
+
+PetscErrorCode UMCreateRefinementInterpolation(PetscInt Nc, IS midparents,
+                                               IS perm, PetscInt mf, Mat *P) {
+    const PetscInt  *amp, *aperm = NULL;
+    const PetscReal half[2] = {0.5, 0.5}, one = 1.0;
+    PetscInt        Nf, rstart, rend, row, n, j;
+
+    PetscCall(ISGetSize(midparents,&Nf));
+    Nf = Nc + Nf / 2;
+    PetscCall(MatCreateAIJ(PETSC_COMM_WORLD,mf,PETSC_DECIDE,Nf,Nc,2,NULL,2,NULL,P));
+    PetscCall(MatGetOwnershipRange(*P,&rstart,&rend));
+    PetscCall(ISGetIndices(midparents,&amp));
+    if (perm) {
+        PetscCall(ISGetIndices(perm,&aperm));
+    }
+    // old nodes are injected; a midpoint averages the ends of its edge
+    for (row = rstart; row < rend; row++) {
+        n = (aperm) ? aperm[row] : row;
+        if (n < Nc) {
+            PetscCall(MatSetValues(*P,1,&row,1,&n,&one,INSERT_VALUES));
+        } else {
+            j = n - Nc;
+            PetscCall(MatSetValues(*P,1,&row,2,amp+2*j,half,INSERT_VALUES));
+        }
+    }
+    if (perm) {
+        PetscCall(ISRestoreIndices(perm,&aperm));
+    }
+    PetscCall(ISRestoreIndices(midparents,&amp));
+    PetscCall(MatAssemblyBegin(*P,MAT_FINAL_ASSEMBLY));
+    PetscCall(MatAssemblyEnd(*P,MAT_FINAL_ASSEMBLY));
+    return 0;
+}
+
+PetscErrorCode UMReorder(UM *mesh) {
+    const PetscInt  *ae, *abf, *ans = NULL, *aperm;
+    PetscInt        *nnz, *inv, *key, *ord, *newe, *newbf, *newns = NULL,
+                    n, k, l, m, p, row[3];
+    PetscReal       *aloc, *aoldloc,
+                    v[9] = {1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0};
+    Mat             adj;
+    IS              cperm;
+    Vec             oldloc;
+
+    if ((mesh->N == 0) || (mesh->K == 0) || (mesh->e == NULL) || (mesh->bf == NULL)) {
+        SETERRQ(PETSC_COMM_SELF,1,
+                "mesh not complete; call UMReadNodes() and UMReadISs() first\n");
+    }
+    if (mesh->l2g || mesh->perm || mesh->geom || mesh->em) {
+        SETERRQ(PETSC_COMM_SELF,2,
+                "mesh already distributed, reordered, or given edge nodes; call UMReorder() first\n");
+    }
+
+    // node adjacency graph as a sequential matrix; each process holds the
+    //   whole mesh and computes the same ordering
+    PetscCall(ISGetIndices(mesh->e,&ae));
+    PetscCall(PetscCalloc1(mesh->N,&nnz));
+    for (k = 0; k < 3*mesh->K; k++)
+        nnz[ae[k]] += 2;  // at most two new neighbors per incident element
+    for (n = 0; n < mesh->N; n++)
+        nnz[n] = PetscMin(nnz[n] + 1,mesh->N);
+    PetscCall(MatCreateSeqAIJ(PETSC_COMM_SELF,mesh->N,mesh->N,0,nnz,&adj));
+    PetscCall(PetscFree(nnz));
+    for (k = 0; k < mesh->K; k++) {
+        for (l = 0; l < 3; l++)
+            row[l] = ae[3*k+l];
+        PetscCall(MatSetValues(adj,3,row,3,row,v,INSERT_VALUES));
+    }
+    PetscCall(MatAssemblyBegin(adj,MAT_FINAL_ASSEMBLY));
+    PetscCall(MatAssemblyEnd(adj,MAT_FINAL_ASSEMBLY));
+    // reverse Cuthill-McKee: new node n is old node perm[n]
+    PetscCall(MatGetOrdering(adj,MATORDERINGRCM,&(mesh->perm),&cperm));
+    PetscCall(ISDestroy(&cperm));
+    PetscCall(MatDestroy(&adj));
+    PetscCall(ISGetIndices(mesh->perm,&aperm));
+    PetscCall(PetscMalloc1(mesh->N,&inv));
+    for (n = 0; n < mesh->N; n++)
+        inv[aperm[n]] = n;
+
+    // permute node coordinates and boundary flags
+    PetscCall(VecDuplicate(mesh->loc,&oldloc));
+    PetscCall(VecCopy(mesh->loc,oldloc));
+    PetscCall(VecGetArrayRead(oldloc,(const PetscReal **)&aoldloc));
+    PetscCall(VecGetArray(mesh->loc,&aloc));
+    for (n = 0; n < mesh->N; n++) {
+        aloc[2*n+0] = aoldloc[2*aperm[n]+0];
+        aloc[2*n+1] = aoldloc[2*aperm[n]+1];
+    }
+    PetscCall(VecRestoreArray(mesh->loc,&aloc));
+    PetscCall(VecRestoreArrayRead(oldloc,(const PetscReal **)&aoldloc));
+    PetscCall(VecDestroy(&oldloc));
+    PetscCall(PetscMalloc1(mesh->N,&newbf));
+    PetscCall(ISGetIndices(mesh->bf,&abf));
+    for (n = 0; n < mesh->N; n++)
+        newbf[n] = abf[aperm[n]];
+    PetscCall(ISRestoreIndices(mesh->bf,&abf));
+    PetscCall(ISRestoreIndices(mesh->perm,&aperm));
+
+    // renumber element nodes, then sort elements by smallest new node index,
+    //   so that consecutive elements share nodes; node order within each
+    //   element, and so its orientation, is unchanged
+    PetscCall(PetscMalloc2(mesh->K,&key,mesh->K,&ord));
+    PetscCall(PetscMalloc1(3*mesh->K,&newe));
+    for (k = 0; k < mesh->K; k++) {
+        key[k] = mesh->N;
+        for (l = 0; l < 3; l++)
+            key[k] = PetscMin(key[k],inv[ae[3*k+l]]);
+        ord[k] = k;
+    }
+    PetscCall(PetscSortIntWithArray(mesh->K,key,ord));
+    for (k = 0; k < mesh->K; k++)
+        for (l = 0; l < 3; l++)
+            newe[3*k+l] = inv[ae[3*ord[k]+l]];
+    PetscCall(ISRestoreIndices(mesh->e,&ae));
+    PetscCall(PetscFree2(key,ord));
+
+    // same for Neumann segments
+    if (mesh->P > 0) {
+        PetscCall(PetscMalloc2(mesh->P,&key,mesh->P,&ord));
+        PetscCall(PetscMalloc1(2*mesh->P,&newns));
+        PetscCall(ISGetIndices(mesh->ns,&ans));
+        for (p = 0; p < mesh->P; p++) {
+            key[p] = PetscMin(inv[ans[2*p+0]],inv[ans[2*p+1]]);
+            ord[p] = p;
+        }
+        PetscCall(PetscSortIntWithArray(mesh->P,key,ord));
+        for (p = 0; p < mesh->P; p++)
+            for (m = 0; m < 2; m++)
+                newns[2*p+m] = inv[ans[2*ord[p]+m]];
+        PetscCall(ISRestoreIndices(mesh->ns,&ans));
+        PetscCall(PetscFree2(key,ord));
+    }
+    PetscCall(PetscFree(inv));
+
+    // replace ISs
+    PetscCall(ISDestroy(&(mesh->e)));
+    PetscCall(ISDestroy(&(mesh->bf)));
+    PetscCall(ISCreateGeneral(PETSC_COMM_SELF,3*mesh->K,newe,PETSC_OWN_POINTER,&(mesh->e)));
+    PetscCall(ISCreateGeneral(PETSC_COMM_SELF,mesh->N,newbf,PETSC_OWN_POINTER,&(mesh->bf)));
+    if (mesh->P > 0) {
+        PetscCall(ISDestroy(&(mesh->ns)));
+        PetscCall(ISCreateGeneral(PETSC_COMM_SELF,2*mesh->P,newns,PETSC_OWN_POINTER,&(mesh->ns)));
+    }
+    return 0;
+}
+
+
+/* Given the owned elements and Neumann segments, as Kloc triples eg[] and
+Ploc pairs nsg[] of global node indices, and their edge nodes emg[] and
+nsmg[] if not NULL, this determines the ghost nodes, converts these arrays
+in place to local node indices, and creates the
+local-to-global map and the ghost scatter.  The ownership range
+rstart,...,rstart+Nown-1 must already be set.  On return *l2gidx is the
+length Nloc array of global indices of local nodes; the caller frees it. */
+static PetscErrorCode UMLocalize(UM *mesh, PetscInt *eg, PetscInt *nsg,
+                                 PetscInt *emg, PetscInt *nsmg,
+                                 PetscInt **l2gidx) {
+    const PetscInt  rend = mesh->rstart + mesh->Nown;
+    PetscInt        *list[4] = {eg, nsg, emg, nsmg},
+                    len[4] = {3*mesh->Kloc, 2*mesh->Ploc, 0, 0},
+                    *gh, *a, ng = 0, n, i, j, loc;
+    Vec             vglobal, vlocal;
+    IS              isg;
+
+    if (emg)
+        len[2] = 3*mesh->Kloc;
+    if (nsmg)
+        len[3] = mesh->Ploc;
+    // collect ghosts: nodes of owned elements and segments which are not owned
+    PetscCall(PetscMalloc1(len[0]+len[1]+len[2]+len[3]+1,&gh));
+    for (i = 0; i < 4; i++) {
+        a = list[i];
+        for (j = 0; j < len[i]; j++)
+            if (a[j] < mesh->rstart || a[j] >= rend)
+                gh[ng++] = a[j];
+    }
+    PetscCall(PetscSortRemoveDupsInt(&ng,gh));
+    mesh->Nloc = mesh->Nown + ng;
+
+    // local numbering: owned nodes in global order, then sorted ghosts
+    PetscCall(PetscMalloc1(mesh->Nloc,l2gidx));
+    for (n = 0; n < mesh->Nown; n++)
+        (*l2gidx)[n] = mesh->rstart + n;
+    for (n = 0; n < ng; n++)
+        (*l2gidx)[mesh->Nown + n] = gh[n];
+    for (i = 0; i < 4; i++) {
+        a = list[i];
+        for (j = 0; j < len[i]; j++) {
+            if (a[j] >= mesh->rstart && a[j] < rend) {
+                a[j] -= mesh->rstart;
+            } else {
+                PetscCall(PetscFindInt(a[j],ng,gh,&loc));
+                a[j] = mesh->Nown + loc;
+            }
+        }
+    }
+    PetscCall(PetscFree(gh));
+
+    // map and scatter; templates have the layout of node-based Vecs
+    PetscCall(ISLocalToGlobalMappingCreate(PETSC_COMM_WORLD,1,mesh->Nloc,
+                  *l2gidx,PETSC_COPY_VALUES,&(mesh->l2g)));
+    PetscCall(VecCreateMPI(PETSC_COMM_WORLD,mesh->Nown,mesh->N,&vglobal));
+    PetscCall(VecCreateSeq(PETSC_COMM_SELF,mesh->Nloc,&vlocal));
+    PetscCall(ISCreateGeneral(PETSC_COMM_SELF,mesh->Nloc,*l2gidx,
+                              PETSC_USE_POINTER,&isg));
+    PetscCall(VecScatterCreate(vglobal,isg,vlocal,NULL,&(mesh->ghostscatter)));
+    PetscCall(ISDestroy(&isg));
+    PetscCall(VecDestroy(&vlocal));
+    PetscCall(VecDestroy(&vglobal));
+    return 0;
+}
+
+PetscErrorCode UMDistribute(UM *mesh) {
+    PetscMPIInt     size;
+    PetscInt        rend, k, p, n, j, *eg, *nsg = NULL, *emg = NULL,
+                    *nsmg = NULL, *l2gidx, *lbf;
+    const PetscInt  *ae, *abf, *ans = NULL, *aem, *ansm;
+    const PetscReal *aloc;
+    PetscReal       *alocl;
+    Vec             locl;
+
+    if ((mesh->N == 0) || (mesh->K == 0) || (mesh->e == NULL) || (mesh->bf == NULL)) {
+        SETERRQ(PETSC_COMM_SELF,1,
+                "mesh not complete; call UMReadNodes() and UMReadISs() first\n");
+    }
+    if (mesh->l2g) {
+        SETERRQ(PETSC_COMM_SELF,2,"mesh already distributed\n");
+    }
+    if (mesh->geom || mesh->colorptr) {
+        SETERRQ(PETSC_COMM_SELF,3,
+                "call UMDistribute() before UMComputeGeometry() or UMColorElements()\n");
+    }
+    // contiguous node ownership ranges, as for node-based Vecs of global
+    //   size N created with local size PETSC_DECIDE
+    mesh->Nown = PETSC_DECIDE;
+    PetscCall(PetscSplitOwnership(PETSC_COMM_WORLD,&(mesh->Nown),&(mesh->N)));
+    PetscCall(MPI_Scan(&(mesh->Nown),&rend,1,MPIU_INT,MPI_SUM,PETSC_COMM_WORLD));
+    mesh->rstart = rend - mesh->Nown;
+
+    PetscCall(MPI_Comm_size(PETSC_COMM_WORLD,&size));
+    if (size == 1) {
+        // everything is owned and there are no ghosts, so keep loc,e,bf,ns
+        Vec  vserial;
+        IS   isall;
+        PetscCall(ISCreateStride(PETSC_COMM_SELF,mesh->N,0,1,&isall));
+        PetscCall(ISLocalToGlobalMappingCreateIS(isall,&(mesh->l2g)));
+        PetscCall(VecCreateSeq(PETSC_COMM_SELF,mesh->N,&vserial));
+        PetscCall(VecScatterCreate(vserial,isall,vserial,isall,&(mesh->ghostscatter)));
+        PetscCall(VecDestroy(&vserial));
+        PetscCall(ISDestroy(&isall));
+        mesh->Nloc = mesh->N;
+        mesh->Kloc = mesh->K;
+        mesh->Ploc = mesh->P;
+        return 0;
+    }
+
+    // own the elements, and Neumann segments, whose first node is owned;
+    //   copy their global node indices
+    PetscCall(ISGetIndices(mesh->e,&ae));
+    mesh->Kloc = 0;
+    for (k = 0; k < mesh->K; k++)
+        if (ae[3*k] >= mesh->rstart && ae[3*k] < rend)
+            mesh->Kloc++;
+    PetscCall(PetscMalloc1(3*mesh->Kloc,&eg));
+    j = 0;
+    for (k = 0; k < mesh->K; k++) {
+        if (ae[3*k] >= mesh->rstart && ae[3*k] < rend) {
+            eg[3*j+0] = ae[3*k+0];
+            eg[3*j+1] = ae[3*k+1];
+            eg[3*j+2] = ae[3*k+2];
+            j++;
+        }
+    }
+    if (mesh->em) {  // edge nodes go with their element
+        PetscCall(ISGetIndices(mesh->em,&aem));
+        PetscCall(PetscMalloc1(3*mesh->Kloc,&emg));
+        j = 0;
+        for (k = 0; k < mesh->K; k++) {
+            if (ae[3*k] >= mesh->rstart && ae[3*k] < rend) {
+                emg[3*j+0] = aem[3*k+0];
+                emg[3*j+1] = aem[3*k+1];
+                emg[3*j+2] = aem[3*k+2];
+                j++;
+            }
+        }
+        PetscCall(ISRestoreIndices(mesh->em,&aem));
+    }
+    PetscCall(ISRestoreIndices(mesh->e,&ae));
+    mesh->Ploc = 0;
+    if (mesh->P > 0) {
+        PetscCall(ISGetIndices(mesh->ns,&ans));
+        for (p = 0; p < mesh->P; p++)
+            if (ans[2*p] >= mesh->rstart && ans[2*p] < rend)
+                mesh->Ploc++;
+        PetscCall(PetscMalloc1(2*mesh->Ploc,&nsg));
+        j = 0;
+        for (p = 0; p < mesh->P; p++) {
+            if (ans[2*p] >= mesh->rstart && ans[2*p] < rend) {
+                nsg[2*j+0] = ans[2*p+0];
+                nsg[2*j+1] = ans[2*p+1];
+                j++;
+            }
+        }
+        if (mesh->nsm) {
+            PetscCall(ISGetIndices(mesh->nsm,&ansm));
+            PetscCall(PetscMalloc1(mesh->Ploc,&nsmg));
+            j = 0;
+            for (p = 0; p < mesh->P; p++)
+                if (ans[2*p] >= mesh->rstart && ans[2*p] < rend)
+                    nsmg[j++] = ansm[p];
+            PetscCall(ISRestoreIndices(mesh->nsm,&ansm));
+        }
+        PetscCall(ISRestoreIndices(mesh->ns,&ans));
+    }
+
+    PetscCall(UMLocalize(mesh,eg,nsg,emg,nsmg,&l2gidx));
+
+    // local boundary flags and coordinates from the whole-mesh versions
+    PetscCall(PetscMalloc1(mesh->Nloc,&lbf));
+    PetscCall(VecCreateSeq(PETSC_COMM_SELF,2*mesh->Nloc,&locl));
+    PetscCall(ISGetIndices(mesh->bf,&abf));
+    PetscCall(VecGetArrayRead(mesh->loc,&aloc));
+    PetscCall(VecGetArray(locl,&alocl));
+    for (n = 0; n < mesh->Nloc; n++) {
+        lbf[n] = abf[l2gidx[n]];
+        alocl[2*n+0] = aloc[2*l2gidx[n]+0];
+        alocl[2*n+1] = aloc[2*l2gidx[n]+1];
+    }
+    PetscCall(VecRestoreArray(locl,&alocl));
+    PetscCall(VecRestoreArrayRead(mesh->loc,&aloc));
+    PetscCall(ISRestoreIndices(mesh->bf,&abf));
+    PetscCall(PetscFree(l2gidx));
+
+    // replace whole-mesh objects by local ones
+    PetscCall(VecDestroy(&(mesh->loc)));
+    PetscCall(ISDestroy(&(mesh->e)));
+    PetscCall(ISDestroy(&(mesh->bf)));
+    PetscCall(ISDestroy(&(mesh->ns)));
+    PetscCall(ISDestroy(&(mesh->em)));
+    PetscCall(ISDestroy(&(mesh->nsm)));
+    mesh->loc = locl;
+    PetscCall(ISCreateGeneral(PETSC_COMM_SELF,3*mesh->Kloc,eg,PETSC_OWN_POINTER,&(mesh->e)));
+    PetscCall(ISCreateGeneral(PETSC_COMM_SELF,mesh->Nloc,lbf,PETSC_OWN_POINTER,&(mesh->bf)));
+    if (mesh->Ploc > 0) {
+        PetscCall(ISCreateGeneral(PETSC_COMM_SELF,2*mesh->Ploc,nsg,PETSC_OWN_POINTER,&(mesh->ns)));
+    } else {
+        PetscCall(PetscFree(nsg));
+    }
+    if (emg) {
+        PetscCall(ISCreateGeneral(PETSC_COMM_SELF,3*mesh->Kloc,emg,PETSC_OWN_POINTER,&(mesh->em)));
+    }
+    if (nsmg && (mesh->Ploc > 0)) {
+        PetscCall(ISCreateGeneral(PETSC_COMM_SELF,mesh->Ploc,nsmg,PETSC_OWN_POINTER,&(mesh->nsm)));
+    } else {
+        PetscCall(PetscFree(nsmg));
+    }
+    // the whole-mesh arrays from UMReadMeshFile(), if any, are now unused
+    if (mesh->map) {
+        munmap(mesh->map,mesh->mapsize);
+        mesh->map = NULL;
+        mesh->mapsize = 0;
+    }
+    return 0;
+}
+
+// node n = j*M+i of the structured mesh is at (i h, j h), h = 1/(M-1),
+//   and is Dirichlet (bf=2) if on the boundary of the unit square
+static void UMStructuredNode(PetscInt M, PetscInt n, PetscReal *x, PetscReal *y,
+                             PetscInt *bf) {
+    const PetscInt  i = n % M, j = n / M;
+    const PetscReal h = 1.0 / (M - 1);
+    *x = i * h;
+    *y = j * h;
+    *bf = (i == 0 || j == 0 || i == M-1 || j == M-1) ? 2 : 0;
+}
+
+/* Same nodes, elements, and boundary flags as genstructured.py.  Cell (i,j)
+has triangles 2c, 2c+1, for c = j(M-1)+i, with nodes A,B,C and B,C+1,C,
+where A = jM+i, B = A+1, C = A+M.  The first node of each triangle is in
+row j, so with distribute the owned elements come from the rows of owned
+nodes only. */
+PetscErrorCode UMCreateStructured(UM *mesh, PetscInt M, PetscBool distribute) {
+    PetscInt   i, j, k, A, n, rend, jlo, jhi, *ae, *abf, *l2gidx;
+    PetscReal  *aloc;
+
+    if ((mesh->N > 0) || (mesh->loc != NULL) || (mesh->e != NULL)) {
+        SETERRQ(PETSC_COMM_SELF,1,"mesh already created?\n");
+    }
+    if (M < 2) {
+        SETERRQ(PETSC_COMM_SELF,2,"structured mesh needs M >= 2 (=%d)\n",M);
+    }
+    mesh->N = M * M;
+    mesh->K = 2 * (M-1) * (M-1);
+    mesh->P = 0;
+    if (!distribute) {
+        // every process holds the whole mesh, as if read from a file
+        PetscCall(PetscMalloc1(3*mesh->K,&ae));
+        PetscCall(PetscMalloc1(mesh->N,&abf));
+        PetscCall(VecCreateSeq(PETSC_COMM_SELF,2*mesh->N,&(mesh->loc)));
+        PetscCall(VecGetArray(mesh->loc,&aloc));
+        for (n = 0; n < mesh->N; n++)
+            UMStructuredNode(M,n,&(aloc[2*n+0]),&(aloc[2*n+1]),&(abf[n]));
+        PetscCall(VecRestoreArray(mesh->loc,&aloc));
+        k = 0;
+        for (j = 0; j < M-1; j++) {
+            for (i = 0; i < M-1; i++) {
+                A = j * M + i;
+                ae[3*k+0] = A;    ae[3*k+1] = A+1;    ae[3*k+2] = A+M;    k++;
+                ae[3*k+0] = A+1;  ae[3*k+1] = A+M+1;  ae[3*k+2] = A+M;    k++;
+            }
+        }
+        PetscCall(ISCreateGeneral(PETSC_COMM_SELF,3*mesh->K,ae,PETSC_OWN_POINTER,&(mesh->e)));
+        PetscCall(ISCreateGeneral(PETSC_COMM_SELF,mesh->N,abf,PETSC_OWN_POINTER,&(mesh->bf)));
+        mesh->Nown = mesh->N;
+        mesh->Nloc = mesh->N;
+        mesh->Kloc = mesh->K;
+        mesh->Ploc = 0;
+        return 0;
+    }
+
+    // as UMDistribute() would do for the whole mesh:  contiguous node
+    //   ownership, and elements owned by the owner of their first node
+    mesh->Nown = PETSC_DECIDE;
+    PetscCall(PetscSplitOwnership(PETSC_COMM_WORLD,&(mesh->Nown),&(mesh->N)));
+    PetscCall(MPI_Scan(&(mesh->Nown),&rend,1,MPIU_INT,MPI_SUM,PETSC_COMM_WORLD));
+    mesh->rstart = rend - mesh->Nown;
+    mesh->Kloc = 0;
+    ae = NULL;
+    if (mesh->Nown > 0) {
+        jlo = mesh->rstart / M;
+        jhi = PetscMin((rend - 1) / M, M-2);
+        PetscCall(PetscMalloc1(6*(M-1)*PetscMax(jhi-jlo+1,0),&ae));
+        for (j = jlo; j <= jhi; j++) {
+            for (i = 0; i < M-1; i++) {
+                A = j * M + i;
+                if (A >= mesh->rstart && A < rend) {
+                    k = mesh->Kloc++;
+                    ae[3*k+0] = A;    ae[3*k+1] = A+1;    ae[3*k+2] = A+M;
+                }
+                if (A+1 >= mesh->rstart && A+1 < rend) {
+                    k = mesh->Kloc++;
+                    ae[3*k+0] = A+1;  ae[3*k+1] = A+M+1;  ae[3*k+2] = A+M;
+                }
+            }
+        }
+    }
+    mesh->Ploc = 0;
+    PetscCall(UMLocalize(mesh,ae,NULL,NULL,NULL,&l2gidx));
+
+    // local coordinates and boundary flags directly from global indices
+    PetscCall(PetscMalloc1(mesh->Nloc,&abf));
+    PetscCall(VecCreateSeq(PETSC_COMM_SELF,2*mesh->Nloc,&(mesh->loc)));
+    PetscCall(VecGetArray(mesh->loc,&aloc));
+    for (n = 0; n < mesh->Nloc; n++)
+        UMStructuredNode(M,l2gidx[n],&(aloc[2*n+0]),&(aloc[2*n+1]),&(abf[n]));
+    PetscCall(VecRestoreArray(mesh->loc,&aloc));
+    PetscCall(PetscFree(l2gidx));
+    PetscCall(ISCreateGeneral(PETSC_COMM_SELF,3*mesh->Kloc,ae,PETSC_OWN_POINTER,&(mesh->e)));
+    PetscCall(ISCreateGeneral(PETSC_COMM_SELF,mesh->Nloc,abf,PETSC_OWN_POINTER,&(mesh->bf)));
+    return 0;
+}
+
+PetscErrorCode UMCreateLocalVec(UM *mesh, Vec *vloc) {
+    PetscCall(VecCreateSeq(PETSC_COMM_SELF,mesh->Nloc,vloc));
+    return 0;
+}
+
+PetscErrorCode UMGlobalToLocal(UM *mesh, Vec g, Vec vloc) {
+    if (!mesh->ghostscatter) {
+        SETERRQ(PETSC_COMM_SELF,1,"ghost scatter not created; call UMDistribute() first\n");
+    }
+    PetscCall(VecScatterBegin(mesh->ghostscatter,g,vloc,INSERT_VALUES,SCATTER_FORWARD));
+    PetscCall(VecScatterEnd(mesh->ghostscatter,g,vloc,INSERT_VALUES,SCATTER_FORWARD));
+    return 0;
+}
+
+PetscErrorCode UMLocalToGlobal(UM *mesh, Vec vloc, InsertMode mode, Vec g) {
+    if (!mesh->ghostscatter) {
+        SETERRQ(PETSC_COMM_SELF,1,"ghost scatter not created; call UMDistribute() first\n");
+    }
+    PetscCall(VecScatterBegin(mesh->ghostscatter,vloc,g,mode,SCATTER_REVERSE));
+    PetscCall(VecScatterEnd(mesh->ghostscatter,vloc,g,mode,SCATTER_REVERSE));
+    return 0;
+}
+
+
+PetscErrorCode UMComputeGeometry(UM *mesh, PetscInt nq,
+                                 const PetscReal xi[], const PetscReal eta[]) {
+    const PetscReal dchi[3][2] = {{-1.0,-1.0},{ 1.0, 0.0},{ 0.0, 1.0}};
+    const PetscInt  *ae, *en;
+    const Node      *aloc;
+    UMGeometry      *g;
+    PetscInt        k, l, r, K = mesh->Kloc;
+    PetscReal       dx1, dx2, dy1, dy2, detJ;
+
+    if ((mesh->e == NULL) || (mesh->loc == NULL)) {
+        SETERRQ(PETSC_COMM_SELF,1,
+                "mesh not complete; call UMReadNodes() and UMReadISs() first\n");
+    }
+    if (mesh->geom) {
+        SETERRQ(PETSC_COMM_SELF,2,"geometry already computed\n");
+    }
+    PetscCall(PetscMalloc1(1,&g));
+    g->Kloc = K;
+    g->nq = nq;
+    PetscCall(PetscMalloc5(K,&(g->absdetJ),3*K,&(g->gx),3*K,&(g->gy),
+                           nq*K,&(g->xq),nq*K,&(g->yq)));
+    PetscCall(ISGetIndices(mesh->e,&ae));
+    PetscCall(UMGetNodeCoordArrayRead(mesh,&aloc));
+    for (k = 0; k < K; k++) {
+        en = ae + 3*k;
+        dx1 = aloc[en[1]].x - aloc[en[0]].x;
+        dx2 = aloc[en[2]].x - aloc[en[0]].x;
+        dy1 = aloc[en[1]].y - aloc[en[0]].y;
+        dy2 = aloc[en[2]].y - aloc[en[0]].y;
+        detJ = dx1 * dy2 - dx2 * dy1;
+        g->absdetJ[k] = PetscAbsReal(detJ);
+        for (l = 0; l < 3; l++) {
+            g->gx[3*k+l] = ( dy2 * dchi[l][0] - dy1 * dchi[l][1]) / detJ;
+            g->gy[3*k+l] = (-dx2 * dchi[l][0] + dx1 * dchi[l][1]) / detJ;
+        }
+        for (r = 0; r < nq; r++) {
+            g->xq[r*K+k] = aloc[en[0]].x + dx1 * xi[r] + dx2 * eta[r];
+            g->yq[r*K+k] = aloc[en[0]].y + dy1 * xi[r] + dy2 * eta[r];
+        }
+    }
+    PetscCall(UMRestoreNodeCoordArrayRead(mesh,&aloc));
+    PetscCall(ISRestoreIndices(mesh->e,&ae));
+    mesh->geom = g;
+    return 0;
+}
+
+PetscErrorCode UMColorElements(UM *mesh) {
+    const PetscInt  *ae;
+    uint64_t        *nodecolors, used;
+    PetscInt        *color, k, l, c;
+
+    if ((mesh->e == NULL) || (mesh->Nloc == 0)) {
+        SETERRQ(PETSC_COMM_SELF,1,
+                "mesh not complete; call UMReadNodes() and UMReadISs() first\n");
+    }
+    if (mesh->colorptr) {
+        SETERRQ(PETSC_COMM_SELF,2,"elements already colored\n");
+    }
+    // greedy: give element k the smallest color not used at its nodes;
+    //   bit c of nodecolors[n] is set if an element at node n has color c
+    PetscCall(PetscCalloc1(mesh->Nloc,&nodecolors));
+    PetscCall(PetscMalloc1(mesh->Kloc,&color));
+    PetscCall(ISGetIndices(mesh->e,&ae));
+    mesh->ncolors = 0;
+    for (k = 0; k < mesh->Kloc; k++) {
+        used = 0;
+        for (l = 0; l < 3; l++)
+            used |= nodecolors[ae[3*k+l]];
+        for (c = 0; c < 64; c++)
+            if (!(used & ((uint64_t)1 << c)))
+                break;
+        if (c == 64) {
+            SETERRQ(PETSC_COMM_SELF,3,"more than 64 colors needed for element %d\n",k);
+        }
+        color[k] = c;
+        for (l = 0; l < 3; l++)
+            nodecolors[ae[3*k+l]] |= (uint64_t)1 << c;
+        mesh->ncolors = PetscMax(mesh->ncolors,c+1);
+    }
+    PetscCall(ISRestoreIndices(mesh->e,&ae));
+    PetscCall(PetscFree(nodecolors));
+    // counting sort of elements by color; within a color, in element order
+    PetscCall(PetscMalloc2(mesh->ncolors+1,&(mesh->colorptr),
+                           mesh->Kloc,&(mesh->colorelems)));
+    for (c = 0; c <= mesh->ncolors; c++)
+        mesh->colorptr[c] = 0;
+    for (k = 0; k < mesh->Kloc; k++)
+        mesh->colorptr[color[k]+1]++;
+    for (c = 0; c < mesh->ncolors; c++)
+        mesh->colorptr[c+1] += mesh->colorptr[c];
+    for (k = 0; k < mesh->Kloc; k++)
+        mesh->colorelems[mesh->colorptr[color[k]]++] = k;
+    for (c = mesh->ncolors; c > 0; c--)  // undo the shift from filling
+        mesh->colorptr[c] = mesh->colorptr[c-1];
+    mesh->colorptr[0] = 0;
+    PetscCall(PetscFree(color));
+    return 0;
+}
+
+PetscErrorCode UMElementEdges(UM *mesh, PetscInt *NE, PetscInt **eedge,
+                              PetscInt **nsedge) {
+    const PetscInt  *ae, *ans;
+    PetscInt        k, l, p;
+    UMEdgeHash      eh;
+
+    if ((mesh->e == NULL) || (mesh->Nloc == 0)) {
+        SETERRQ(PETSC_COMM_SELF,1,
+                "mesh not complete; call UMReadNodes() and UMReadISs() first\n");
+    }
+    PetscCall(UMEdgeHashCreate(3*mesh->Kloc,&eh));
+    PetscCall(PetscMalloc1(3*mesh->Kloc,eedge));
+    PetscCall(ISGetIndices(mesh->e,&ae));
+    for (k = 0; k < mesh->Kloc; k++)
+        for (l = 0; l < 3; l++)
+            (*eedge)[3*k+l] = UMEdgeHashLookup(&eh,ae[3*k+l],ae[3*k+(l+1)%3],
+                                               PETSC_TRUE,NULL);
+    PetscCall(ISRestoreIndices(mesh->e,&ae));
+    *NE = eh.n;
+    if (nsedge) {
+        *nsedge = NULL;
+        if (mesh->Ploc > 0) {
+            PetscCall(PetscMalloc1(mesh->Ploc,nsedge));
+            PetscCall(ISGetIndices(mesh->ns,&ans));
+            for (p = 0; p < mesh->Ploc; p++) {
+                (*nsedge)[p] = UMEdgeHashLookup(&eh,ans[2*p+0],ans[2*p+1],
+                                                PETSC_FALSE,NULL);
+                if ((*nsedge)[p] < 0) {
+                    SETERRQ(PETSC_COMM_SELF,2,
+                            "Neumann segment %d is not an element edge\n",p);
+                }
+            }
+            PetscCall(ISRestoreIndices(mesh->ns,&ans));
+        }
+    }
+    PetscCall(UMEdgeHashDestroy(&eh));
+    return 0;
+}
 
 PetscErrorCode UMStats(UM *mesh, PetscReal *maxh, PetscReal *meanh,
                        PetscReal *maxa, PetscReal *meana) {
@@ -254,7 +2209,11 @@ PetscErrorCode UMStats(UM *mesh, PetscReal *maxh, PetscReal *meanh,
     }
     PetscCall(UMGetNodeCoordArrayRead(mesh,&aloc));
     PetscCall(ISGetIndices(mesh->e,&ae));
-    for (k = 0; k < mesh->K; k++) {
+#if defined(_OPENMP)
+#pragma omp parallel for private(x,y,ax,ay,bx,by,cx,cy,h,a) \
+        reduction(max:Maxh,Maxa) reduction(+:Sumh,Suma)
+#endif
+    for (k = 0; k < mesh->Kloc; k++) {
         x[0] = aloc[ae[3*k]].x;
         y[0] = aloc[ae[3*k]].y;
         x[1] = aloc[ae[3*k+1]].x;
@@ -277,6 +2236,12 @@ PetscErrorCode UMStats(UM *mesh, PetscReal *maxh, PetscReal *meanh,
     }
     PetscCall(ISRestoreIndices(mesh->e,&ae));
     PetscCall(UMRestoreNodeCoordArrayRead(mesh,&aloc));
+    if (mesh->l2g) {  // each element is owned by exactly one process
+        PetscCall(MPI_Allreduce(MPI_IN_PLACE,&Maxh,1,MPIU_REAL,MPI_MAX,PETSC_COMM_WORLD));
+        PetscCall(MPI_Allreduce(MPI_IN_PLACE,&Maxa,1,MPIU_REAL,MPI_MAX,PETSC_COMM_WORLD));
+        PetscCall(MPI_Allreduce(MPI_IN_PLACE,&Sumh,1,MPIU_REAL,MPI_SUM,PETSC_COMM_WORLD));
+        PetscCall(MPI_Allreduce(MPI_IN_PLACE,&Suma,1,MPIU_REAL,MPI_SUM,PETSC_COMM_WORLD));
+    }
     if (maxh)  *maxh = Maxh;
     if (maxa)  *maxa = Maxa;
     if (meanh)  *meanh = Sumh / mesh->K;
@@ -284,6 +2249,169 @@ PetscErrorCode UMStats(UM *mesh, PetscReal *maxh, PetscReal *meanh,
     return 0;
 }
 
+static const PetscReal aspectbins[UM_NHIST-1] = {1.5, 2.0, 3.0, 5.0, 10.0};
+
+PetscErrorCode UMQuality(UM *mesh, UMQualityReport *qr) {
+    const PetscReal rad2deg = 180.0 / PETSC_PI;
+    const PetscInt  *ae, *aem = NULL;
+    const Node      *aloc;
+    PetscInt        *nodecount, k, j, b, en[3], orphan = 0,
+                    ahist[UM_NHIST], rhist[UM_NHIST], neg = 0, deg = 0, dup = 0;
+    PetscReal       la, lb, lc, lmin, lmax, lmid, detJ, area, cosang, amin,
+                    amax, aspect, minangle = 180.0, maxangle = 0.0, *acount;
+    Vec             countloc, countglobal;
+
+    if ((mesh->e == NULL) || (mesh->loc == NULL)) {
+        SETERRQ(PETSC_COMM_SELF,1,
+                "mesh not complete; call UMReadNodes() and UMReadISs() first\n");
+    }
+    for (b = 0; b < UM_NHIST; b++) {
+        ahist[b] = 0;
+        rhist[b] = 0;
+    }
+    PetscCall(PetscCalloc1(mesh->Nloc,&nodecount));
+    PetscCall(UMGetNodeCoordArrayRead(mesh,&aloc));
+    PetscCall(ISGetIndices(mesh->e,&ae));
+    if (mesh->em) {
+        PetscCall(ISGetIndices(mesh->em,&aem));
+    }
+#if defined(_OPENMP)
+#pragma omp parallel for private(j,b,en,la,lb,lc,lmin,lmax,lmid,detJ,area,cosang,amin,amax,aspect) \
+        reduction(min:minangle) reduction(max:maxangle) \
+        reduction(+:neg,deg,dup,ahist[:UM_NHIST],rhist[:UM_NHIST])
+#endif
+    for (k = 0; k < mesh->Kloc; k++) {
+        for (j = 0; j < 3; j++) {
+            en[j] = ae[3*k+j];
+#if defined(_OPENMP)
+#pragma omp atomic
+#endif
+            nodecount[en[j]]++;
+        }
+        if (aem) {
+            for (j = 0; j < 3; j++) {
+#if defined(_OPENMP)
+#pragma omp atomic
+#endif
+                nodecount[aem[3*k+j]]++;
+            }
+        }
+        if ((en[0] == en[1]) || (en[1] == en[2]) || (en[2] == en[0])) {
+            dup++;
+            continue;
+        }
+        detJ = (aloc[en[1]].x - aloc[en[0]].x) * (aloc[en[2]].y - aloc[en[0]].y)
+               - (aloc[en[2]].x - aloc[en[0]].x) * (aloc[en[1]].y - aloc[en[0]].y);
+        if (detJ < 0.0)
+            neg++;
+        // side lengths; side opposite node j
+        la = PetscSqrtReal(PetscSqr(aloc[en[1]].x - aloc[en[2]].x)
+                           + PetscSqr(aloc[en[1]].y - aloc[en[2]].y));
+        lb = PetscSqrtReal(PetscSqr(aloc[en[2]].x - aloc[en[0]].x)
+                           + PetscSqr(aloc[en[2]].y - aloc[en[0]].y));
+        lc = PetscSqrtReal(PetscSqr(aloc[en[0]].x - aloc[en[1]].x)
+                           + PetscSqr(aloc[en[0]].y - aloc[en[1]].y));
+        lmin = PetscMin(la,PetscMin(lb,lc));
+        lmax = PetscMax(la,PetscMax(lb,lc));
+        lmid = la + lb + lc - lmin - lmax;
+        area = 0.5 * PetscAbsReal(detJ);
+        if (area <= 1.0e-12 * lmax * lmax) {
+            deg++;
+            continue;
+        }
+        // smallest angle is opposite shortest side, largest opposite longest
+        cosang = (lmid * lmid + lmax * lmax - lmin * lmin) / (2.0 * lmid * lmax);
+        amin = rad2deg * PetscAcosReal(PetscMin(1.0,PetscMax(-1.0,cosang)));
+        cosang = (lmin * lmin + lmid * lmid - lmax * lmax) / (2.0 * lmin * lmid);
+        amax = rad2deg * PetscAcosReal(PetscMin(1.0,PetscMax(-1.0,cosang)));
+        minangle = PetscMin(minangle,amin);
+        maxangle = PetscMax(maxangle,amax);
+        ahist[PetscMin((PetscInt)(amin / 10.0),UM_NHIST-1)]++;
+        // R/(2r) where R = la lb lc / (4 area) and r = 2 area / (la+lb+lc)
+        aspect = la * lb * lc * (la + lb + lc) / (16.0 * area * area);
+        for (b = 0; b < UM_NHIST-1; b++)
+            if (aspect < aspectbins[b])
+                break;
+        rhist[b]++;
+    }
+    PetscCall(ISRestoreIndices(mesh->e,&ae));
+    if (aem) {
+        PetscCall(ISRestoreIndices(mesh->em,&aem));
+    }
+    PetscCall(UMRestoreNodeCoordArrayRead(mesh,&aloc));
+
+    // orphan nodes; after UMDistribute() sum incident-element counts onto
+    //   owning processes
+    if (mesh->l2g) {
+        PetscCall(UMCreateLocalVec(mesh,&countloc));
+        PetscCall(VecGetArray(countloc,&acount));
+        for (j = 0; j < mesh->Nloc; j++)
+            acount[j] = (PetscReal)nodecount[j];
+        PetscCall(VecRestoreArray(countloc,&acount));
+        PetscCall(VecCreateMPI(PETSC_COMM_WORLD,mesh->Nown,mesh->N,&countglobal));
+        PetscCall(VecSet(countglobal,0.0));
+        PetscCall(UMLocalToGlobal(mesh,countloc,ADD_VALUES,countglobal));
+        PetscCall(VecGetArray(countglobal,&acount));
+        for (j = 0; j < mesh->Nown; j++)
+            if (acount[j] == 0.0)
+                orphan++;
+        PetscCall(VecRestoreArray(countglobal,&acount));
+        PetscCall(VecDestroy(&countglobal));
+        PetscCall(VecDestroy(&countloc));
+    } else {
+        for (j = 0; j < mesh->Nloc; j++)
+            if (nodecount[j] == 0)
+                orphan++;
+    }
+    PetscCall(PetscFree(nodecount));
+
+    if (mesh->l2g) {  // each element and node is owned by exactly one process
+        PetscCall(MPI_Allreduce(MPI_IN_PLACE,&minangle,1,MPIU_REAL,MPI_MIN,PETSC_COMM_WORLD));
+        PetscCall(MPI_Allreduce(MPI_IN_PLACE,&maxangle,1,MPIU_REAL,MPI_MAX,PETSC_COMM_WORLD));
+        PetscCall(MPI_Allreduce(MPI_IN_PLACE,ahist,UM_NHIST,MPIU_INT,MPI_SUM,PETSC_COMM_WORLD));
+        PetscCall(MPI_Allreduce(MPI_IN_PLACE,rhist,UM_NHIST,MPIU_INT,MPI_SUM,PETSC_COMM_WORLD));
+        PetscCall(MPI_Allreduce(MPI_IN_PLACE,&neg,1,MPIU_INT,MPI_SUM,PETSC_COMM_WORLD));
+        PetscCall(MPI_Allreduce(MPI_IN_PLACE,&deg,1,MPIU_INT,MPI_SUM,PETSC_COMM_WORLD));
+        PetscCall(MPI_Allreduce(MPI_IN_PLACE,&dup,1,MPIU_INT,MPI_SUM,PETSC_COMM_WORLD));
+        PetscCall(MPI_Allreduce(MPI_IN_PLACE,&orphan,1,MPIU_INT,MPI_SUM,PETSC_COMM_WORLD));
+    }
+    qr->minangle = minangle;
+    qr->maxangle = maxangle;
+    for (b = 0; b < UM_NHIST; b++) {
+        qr->anglehist[b] = ahist[b];
+        qr->aspecthist[b] = rhist[b];
+    }
+    qr->negative = neg;
+    qr->degenerate = deg;
+    qr->duplicate = dup;
+    qr->orphan = orphan;
+    return 0;
+}
+
+PetscErrorCode UMQualityView(UMQualityReport *qr, PetscViewer viewer) {
+    const char *anglelabel[UM_NHIST] = {"[ 0,10)","[10,20)","[20,30)",
+                                        "[30,40)","[40,50)","[50,60]"},
+               *aspectlabel[UM_NHIST] = {"[ 1,1.5)","[1.5, 2)","[ 2,  3)",
+                                         "[ 3,  5)","[ 5, 10)","[10,inf)"};
+    PetscInt   b;
+    PetscCall(PetscViewerASCIIPrintf(viewer,"mesh quality:\n"));
+    PetscCall(PetscViewerASCIIPrintf(viewer,"  angles in [%.3f,%.3f] degrees\n",
+                                     qr->minangle,qr->maxangle));
+    PetscCall(PetscViewerASCIIPrintf(viewer,"  elements by smallest angle (degrees):\n"));
+    for (b = 0; b < UM_NHIST; b++) {
+        PetscCall(PetscViewerASCIIPrintf(viewer,"    %s : %d\n",anglelabel[b],qr->anglehist[b]));
+    }
+    PetscCall(PetscViewerASCIIPrintf(viewer,"  elements by aspect ratio R/(2r):\n"));
+    for (b = 0; b < UM_NHIST; b++) {
+        PetscCall(PetscViewerASCIIPrintf(viewer,"    %s : %d\n",aspectlabel[b],qr->aspecthist[b]));
+    }
+    PetscCall(PetscViewerASCIIPrintf(viewer,
+                  "  %d negatively-oriented, %d degenerate, %d with repeated nodes\n",
+                  qr->negative,qr->degenerate,qr->duplicate));
+    PetscCall(PetscViewerASCIIPrintf(viewer,"  %d orphan nodes\n",qr->orphan));
+    return 0;
+}
+
 PetscErrorCode UMGetNodeCoordArrayRead(UM *mesh, const Node **xy) {
     if ((!mesh->loc) || (mesh->N == 0)) {
         SETERRQ(PETSC_COMM_SELF,1,"node coordinates not created ... stopping\n");
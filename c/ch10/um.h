@@ -7,6 +7,17 @@ typedef struct {
     PetscReal  x,y;
 } Node;
 
+// optional cache of geometry of owned elements; see UMComputeGeometry()
+typedef struct {
+    PetscInt   Kloc,    // number of elements
+               nq;      // number of quadrature points per element
+    PetscReal  *absdetJ,// |det J| of map from reference element; length Kloc
+               *gx,     // hat function gradients; length 3 Kloc; entry
+               *gy,     //     3*k+l is for local node l of element k
+               *xq,     // quadrature point coordinates; length nq Kloc;
+               *yq;     //     entry r*Kloc+k is for point r in element k
+} UMGeometry;
+
 // data type for an Unstructured Mesh
 typedef struct {
     PetscInt N,     // number of nodes
@@ -22,6 +33,36 @@ typedef struct {
              ns;    // Neumann boundary segment pairs; length 2P;
                     //     may be a null ptr; values s[2*p+0],s[2*p+1]
                     //     are indices into node-based Vecs
+    IS       em,    // if UMAddEdgeNodes() was called, the edge node of each
+                    //     element edge; length 3K; em[3*k+l] is on the
+                    //     edge from e[3*k+l] to e[3*k+(l+1)%3]; else NULL
+             nsm;   // edge node of each Neumann segment; length P; or NULL
+    PetscInt Nedge; // number of edge nodes; these are the last Nedge of N
+    PetscBool nvb;  // if UMRefineMarked() was called, the edge from e[3*k+0]
+                    //     to e[3*k+1] is the refinement edge of element k
+                    //     and e[3*k+2] is its newest vertex; else false
+    IS       perm;  // if UMReorder() was called, node n is node perm[n]
+                    //     of the mesh as read; length N; else NULL
+    // the on-process part of the mesh; before UMDistribute() each process
+    //   holds the whole mesh, so Nown = Nloc = N, Kloc = K, and Ploc = P;
+    //   after UMDistribute() the fields loc,e,bf,ns above are sequential
+    //   and describe only the local part, using local node indices
+    PetscInt Nown,  // number of owned nodes; local indices 0,...,Nown-1
+                    //     are global indices rstart,...,rstart+Nown-1
+             Nloc,  // number of local nodes; owned nodes then ghost nodes
+             Kloc,  // number of owned elements
+             Ploc,  // number of owned Neumann boundary segments
+             rstart;// global index of first owned node
+    ISLocalToGlobalMapping l2g;   // local to global node indices
+    VecScatter ghostscatter;      // global node-based Vec to local
+                                  //     (owned plus ghost) node-based Vec
+    UMGeometry *geom;             // NULL unless UMComputeGeometry() called
+    PetscInt   ncolors,           // element coloring from UMColorElements():
+               *colorptr,         //     elements colorelems[colorptr[c]],...,
+               *colorelems;       //     colorelems[colorptr[c+1]-1] have color
+                                  //     c and share no nodes; else NULL
+    void       *map;              // memory-mapped mesh file, if read by
+    size_t     mapsize;           //     UMReadMeshFile(); else NULL and 0
 } UM;
 //ENDSTRUCT
 
@@ -38,16 +79,155 @@ PetscErrorCode UMReadNodes(UM *mesh, char *filename);
 //   and boundary flags into them; call UMReadNodes() first
 PetscErrorCode UMReadISs(UM *mesh, char *filename);
 
-// view all fields in UM to the viewer
+// alternative to UMReadNodes() and UMReadISs(): memory-map a single .um
+//   mesh file, with header and contiguous arrays (see umfile.py), and use
+//   its arrays for loc,e,bf,ns without copying
+PetscErrorCode UMReadMeshFile(UM *mesh, char *filename);
+
+// alternative to the above: read a Gmsh .msh file directly, in format 2.2
+//   or 4.1, ASCII or binary; physical names "dirichlet", "neumann", and
+//   "interior" give bf flags and Neumann segments as in msh2petsc.py; the
+//   file is streamed, and every process reads all of it
+PetscErrorCode UMReadGmsh(UM *mesh, char *filename);
+
+// alternative to reading a mesh: create the structured mesh of genstructured.py
+//   in memory, with M x M nodes on the unit square, two triangles per cell,
+//   and Dirichlet flags on the whole boundary; with distribute each process
+//   generates only its part, giving the same result as UMDistribute() on the
+//   whole mesh (so do not call UMDistribute(), UMRefineUniform(), UMReorder(),
+//   or UMAddEdgeNodes() afterward); without distribute every process holds
+//   the whole mesh, as after UMReadISs()
+PetscErrorCode UMCreateStructured(UM *mesh, PetscInt M, PetscBool distribute);
+
+// refine uniformly in place, splitting each element into four ("red"
+//   refinement) by adding a node at the midpoint of each edge; new nodes are
+//   numbered after the old, child elements of old element k are 4k,...,4k+3,
+//   and Neumann segments split in two; bf flags of midpoints are 1 on Neumann
+//   segments, 2 on other boundary edges, 0 otherwise; if midparents is not
+//   NULL it returns the 2(Nnew-Nold) endpoint indices of the refined edges, so
+//   new node Nold+j is the midpoint of nodes midparents[2j],midparents[2j+1];
+//   call after UMReadISs() and before UMReorder() and UMDistribute()
+PetscErrorCode UMRefineUniform(UM *mesh, IS *midparents);
+
+// refine locally in place by newest-vertex bisection: each element k with
+//   marked[k] true is bisected at least once, and further elements as needed
+//   to keep the mesh conforming; the first call labels each element by its
+//   longest edge; new nodes are numbered after the old, Neumann segments are
+//   split when refined, and bf flags and midparents are as in
+//   UMRefineUniform(), so UMCreateRefinementInterpolation() applies; may be
+//   called again after UMDistribute(), but on one process only, and not
+//   after UMReorder() or UMAddEdgeNodes(); drops geometry and coloring
+PetscErrorCode UMRefineMarked(UM *mesh, const PetscBool *marked, IS *midparents);
+
+// create the P1 interpolation (prolongation) matrix, of size Nf x Nc, from
+//   a mesh with Nc nodes to its refinement by UMRefineUniform() or
+//   UMRefineMarked(), which returned midparents; if the refined mesh was then
+//   reordered, give its perm, else NULL; mf is the number of locally-owned
+//   rows (fine nodes), or PETSC_DECIDE; columns are distributed by PETSC_DECIDE
+PetscErrorCode UMCreateRefinementInterpolation(PetscInt Nc, IS midparents,
+                                               IS perm, PetscInt mf, Mat *P);
+
+// renumber nodes by reverse Cuthill-McKee, and sort elements and Neumann
+//   segments by their smallest new node index, for locality of element
+//   loops; permutes loc,e,bf,ns consistently and keeps perm so that
+//   UMViewSolutionBinary() writes in the original order; optional, and
+//   call after UMReadISs() and before UMDistribute()
+PetscErrorCode UMReorder(UM *mesh);
+
+// add a node at the midpoint of each edge, as needed by P2 elements, and
+//   record them in em,nsm; edge nodes are numbered after the vertices, with
+//   boundary flags as in UMRefineUniform(); elements stay vertex triples in
+//   e, so geometry, statistics, and coloring are unchanged; call after
+//   UMReorder() (if used) and before UMDistribute()
+PetscErrorCode UMAddEdgeNodes(UM *mesh);
+
+// partition the elements and Neumann boundary segments among processes,
+//   so that each process owns a contiguous range of nodes and the elements
+//   whose first node it owns; builds owned plus ghost node sets and the
+//   scatter for ghost values; call after UMReadISs() and before solving,
+//   even on one process
+PetscErrorCode UMDistribute(UM *mesh);
+
+// create a sequential Vec of length Nloc for local (owned plus ghost) values
+PetscErrorCode UMCreateLocalVec(UM *mesh, Vec *vloc);
+
+// scatter global node-based Vec to local Vec, including ghost values
+PetscErrorCode UMGlobalToLocal(UM *mesh, Vec g, Vec vloc);
+
+// sum (ADD_VALUES) or insert (INSERT_VALUES) local values into global Vec
+PetscErrorCode UMLocalToGlobal(UM *mesh, Vec vloc, InsertMode mode, Vec g);
+
+// compute and store |det J|, hat function gradients, and quadrature point
+//   coordinates for the owned elements; the nq quadrature points are given
+//   by (xi[r],eta[r]) on the reference triangle; call after UMDistribute()
+PetscErrorCode UMComputeGeometry(UM *mesh, PetscInt nq,
+                                 const PetscReal xi[], const PetscReal eta[]);
+
+// color the owned elements so that elements of the same color share no
+//   node; greedy, using at most 64 colors; call after UMDistribute()
+PetscErrorCode UMColorElements(UM *mesh);
+
+// number the edges of the owned elements: eedge[3*k+l] is the index of the
+//   edge from local node l to local node l+1 (mod 3) of element k, and, if
+//   nsedge is not NULL and Ploc > 0, nsedge[p] is that of Neumann segment p;
+//   an edge between processes is seen from one side on each, so this is for
+//   whole-mesh use; the caller frees eedge and nsedge
+PetscErrorCode UMElementEdges(UM *mesh, PetscInt *NE, PetscInt **eedge,
+                              PetscInt **nsedge);
+
+// view all fields in UM to the viewer; the binary solution view writes
+//   only values at vertices, in the node order of the mesh as read
 PetscErrorCode UMViewASCII(UM *mesh, PetscViewer viewer);
 PetscErrorCode UMViewSolutionBinary(UM *mesh, char *filename, Vec u);
 
+// XDMF output, readable by ParaView and VisIt:  mesh and node-based fields
+//   go, as raw big-endian arrays, into root.bin, which is described by
+//   root.xmf; UMXDMFCreate() writes node coordinates and element node lists
+//   (Triangle, or Triangle_6 for P2) in the global node order, and each
+//   UMXDMFAppendField() appends one field without rewriting the mesh;
+//   each process writes its owned part, using MPI-IO if PETSc has it;
+//   collective, and call after UMDistribute()
+#define UM_XDMF_MAXFIELDS 32
+typedef struct {
+    char      root[PETSC_MAX_PATH_LEN];  // file names are root.xmf, root.bin
+    PetscInt  N, K,    // global numbers of nodes and elements
+              nen,     // nodes per element; 3, or 6 for P2
+              nfields; // number of fields appended so far
+    char      fieldname[UM_XDMF_MAXFIELDS][64];
+} UMXDMF;
+
+PetscErrorCode UMXDMFCreate(UM *mesh, const char *root, UMXDMF *xdmf);
+PetscErrorCode UMXDMFAppendField(UM *mesh, UMXDMF *xdmf, Vec u,
+                                 const char *name);
+
 // compute statistics for mesh:  maxh,meanh are for triangle side
-//   lengths; maxa,meana are for areas
+//   lengths; maxa,meana are for areas; collective after UMDistribute()
 PetscErrorCode UMStats(UM *mesh, PetscReal *maxh, PetscReal *meanh,
                        PetscReal *maxa, PetscReal *meana);
 
-// access to a length-N array of structs for nodal coordinates
+// mesh quality report from UMQuality()
+#define UM_NHIST 6
+typedef struct {
+    PetscReal minangle,  // smallest and largest interior angle (degrees)
+              maxangle;  //     over non-degenerate elements
+    PetscInt  anglehist[UM_NHIST],  // element counts by smallest angle in
+                                    //     [0,10),[10,20),...,[50,60] degrees
+              aspecthist[UM_NHIST], // element counts by aspect ratio R/(2r),
+                                    //     circumradius over twice inradius, in
+                                    //     [1,1.5),[1.5,2),[2,3),[3,5),[5,10),
+                                    //     [10,inf)
+              negative,  // elements with det J < 0 (clockwise)
+              degenerate,// elements with zero area, up to rounding
+              duplicate, // elements with a repeated node index
+              orphan;    // nodes in no element
+} UMQualityReport;
+
+// single pass over elements to compute quality report; OpenMP-threaded if
+//   built with OpenMP; collective after UMDistribute()
+PetscErrorCode UMQuality(UM *mesh, UMQualityReport *qr);
+PetscErrorCode UMQualityView(UMQualityReport *qr, PetscViewer viewer);
+
+// access to a length-Nloc array of structs for nodal coordinates
 PetscErrorCode UMGetNodeCoordArrayRead(UM *mesh, const Node **xy);
 PetscErrorCode UMRestoreNodeCoordArrayRead(UM *mesh, const Node **xy);
 //ENDDECLARE
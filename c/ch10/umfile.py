@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+#
+# (C) 2018-2020 Ed Bueler
+
+# Write a single-file .um mesh, readable (by memory-mapping) by UMReadMeshFile()
+# in um.c.  As a script, convert a .vec,.is pair of PETSc binary files to .um.
+# As a module, see writeum(); msh2petsc.py uses it for option -um.
+
+# example: create meshes/trap1.um from meshes/trap1.vec and meshes/trap1.is
+#    $ make petscPyScripts
+#    $ ./umfile.py meshes/trap1
+#    $ ./unfem -un_mesh meshes/trap1.um
+
+# The format:  8 characters "P4PDESUM" then ten 64-bit integers
+#     version (=1), intsize, realsize, N, K, P, offloc, offe, offbf, offns
+# where offX is the byte offset of array X (offns = 0 if P = 0).  Then follow
+# the arrays, each starting on an 8-byte boundary, in native byte order:
+#     loc   2N reals     x,y coordinates of nodes
+#     e     3K ints      element triples
+#     bf    N ints       boundary flags
+#     ns    2P ints      Neumann boundary segments
+# intsize and realsize must match sizeof(PetscInt) and sizeof(PetscReal).
+
+import numpy as np
+
+MAGIC = b'P4PDESUM'
+VERSION = 1
+
+def _padto8(n):
+    return (n + 7) // 8 * 8
+
+def writeum(filename,xy,e,bf,ns,intsize=4,realsize=8):
+    '''Write a .um mesh file.  Arguments xy,e,bf,ns are as in the .vec,.is
+    files; ns may be empty or None if there are no Neumann segments.'''
+    itype = {4: np.int32, 8: np.int64}[intsize]
+    rtype = {4: np.float32, 8: np.float64}[realsize]
+    xy = np.asarray(xy,dtype=rtype)
+    e = np.asarray(e,dtype=itype)
+    bf = np.asarray(bf,dtype=itype)
+    if ns is None or len(ns) == 0 or ns[0] < 0:  # also old negative kluge
+        ns = np.zeros(0,dtype=itype)
+    ns = np.asarray(ns,dtype=itype)
+    assert (len(xy) % 2 == 0), 'coordinate list length not 2 N'
+    assert (len(e) % 3 == 0), 'element index list length not 3 K'
+    assert (len(ns) % 2 == 0), 'Neumann segment index list length not 2 P'
+    N, K, P = len(xy) // 2, len(e) // 3, len(ns) // 2
+    assert (len(bf) == N), 'boundary flag list not length N'
+    arrays = [xy, e, bf, ns]
+    offsets = []
+    off = len(MAGIC) + 10 * 8
+    for a in arrays:
+        offsets.append(off if len(a) > 0 else 0)
+        off = _padto8(off + a.nbytes)
+    hdr = np.array([VERSION,intsize,realsize,N,K,P] + offsets,dtype=np.int64)
+    with open(filename, 'wb') as umfile:
+        umfile.write(MAGIC)
+        umfile.write(hdr.tobytes())
+        for a in arrays:
+            umfile.write(a.tobytes())
+            umfile.write(bytes(_padto8(a.nbytes) - a.nbytes))
+    return N, K, P
+
+if __name__ == "__main__":
+    import argparse
+
+    parser = argparse.ArgumentParser(description= \
+'''Converts PETSc binary files root.vec and root.is, as written by
+msh2petsc.py or genstructured.py, into a single mesh file root.um.
+Needs link to ${PETSC_DIR}/lib/petsc/bin/PetscBinaryIO.py.''')
+    parser.add_argument('-int64', default=False, action='store_true',
+                        help='write 64-bit ints (for PETSc --with-64-bit-indices)')
+    parser.add_argument('root', metavar='NAMEROOT',
+                        help='file name root of input .vec,.is and output .um')
+    args = parser.parse_args()
+
+    import PetscBinaryIO
+
+    petsc = PetscBinaryIO.PetscBinaryIO()
+    xy = petsc.readBinaryFile(args.root + '.vec')[0]
+    e, bf, ns = petsc.readBinaryFile(args.root + '.is')
+    outname = args.root + '.um'
+    N, K, P = writeum(outname,xy,e,bf,ns,intsize=8 if args.int64 else 4)
+    print('  wrote N=%d nodes, K=%d elements, P=%d Neumann segments to %s' \
+          % (N,K,P,outname))
@@ -19,10 +19,42 @@ typedef struct {
     PetscInt  solncase,
               quaddegree;
     PetscReal (*a_fcn)(PetscReal, PetscReal, PetscReal);
+    PetscReal (*dadu_fcn)(PetscReal, PetscReal, PetscReal);
     PetscReal (*f_fcn)(PetscReal, PetscReal, PetscReal);
+    PetscReal (*dfdu_fcn)(PetscReal, PetscReal, PetscReal);
     PetscReal (*gD_fcn)(PetscReal, PetscReal);
     PetscReal (*gN_fcn)(PetscReal, PetscReal);
     PetscReal (*uexact_fcn)(PetscReal, PetscReal);
+    // batched versions of a_fcn(), f_fcn(); see cases.h
+    void      (*a_batch)(PetscInt, const PetscReal*, const PetscReal*,
+                         const PetscReal*, PetscReal*);
+    void      (*f_batch)(PetscInt, const PetscReal*, const PetscReal*,
+                         const PetscReal*, PetscReal*);
+    PetscBool batch;       // compute residual UNFEM_BATCH elements at a time
+    PetscBool p2;          // P2 elements, using edge nodes of the UM
+    Vec       uloc, Floc;  // local (owned plus ghost) work Vecs
+    PetscBool f_uindep;    // true if f_fcn() does not depend on u
+    PetscReal *gD,         // g_D at local nodes; length Nloc
+              *fq;         // if f_uindep: f at quadrature points of owned
+                           //     elements; length q.n Kloc, as in UMGeometry
+    PetscInt  neumannpts;  // Gauss-Legendre points per Neumann segment
+    Vec       gN;          // Neumann load, int g_N psi ds at each node; a
+                           //     global Vec, or NULL if there are no segments
+    PetscBool newton;      // Jacobian includes da/du, df/du terms (Newton)
+                           //     or not (Picard)
+    // for -un_matfree: the Jacobian is a MATSHELL whose action uses a(u),
+    //   da/du(u), and df/du(u) at quadrature points, and grad u on
+    //   elements, all saved by FormShellJacobian(); the preconditioner is
+    //   the Picard matrix, reassembled every picardlag Jacobian evaluations
+    PetscInt  picardlag, jaccount;
+    PetscInt  *eoff,       // for MATSEQAIJ: offsets in the value array of the
+              *doff;       //     3x3 entries of each element (-1 if either
+                           //     node is Dirichlet), and of the diagonal
+                           //     of Dirichlet rows; see FormPicard()
+    Vec       ujac, vloc;  // local u at Jacobian evaluation; local MatMult() input
+    PetscReal *aq, *daq,   // length q.n Kloc, as in UMGeometry
+              *dfq,
+              *gradu;      // length 2 Kloc
     PetscLogStage readstage, setupstage, solverstage, resstage, jacstage;  //STRIP
 } unfemCtx;
 //ENDCTX
@@ -45,37 +77,127 @@ PetscReal eval(const PetscReal v[3], PetscReal xi, PetscReal eta) {
 }
 //ENDFEM
 
+// geometry of element k, with nodes en[0],en[1],en[2]: |det J|, hat function
+//   gradients, and coordinates of quadrature points; read from the UM
+//   geometry cache if it exists
+static void ElementGeometry(const UM *mesh, const Quad2DTri *q, PetscInt k,
+                            const PetscInt *en, const Node *aloc,
+                            PetscReal *absdetJ, PetscReal gradpsi[3][2],
+                            PetscReal xq[], PetscReal yq[]) {
+    const UMGeometry *g = mesh->geom;
+    PetscReal        dx1, dx2, dy1, dy2, detJ;
+    PetscInt         l, r;
+    if (g) {
+        *absdetJ = g->absdetJ[k];
+        for (l = 0; l < 3; l++) {
+            gradpsi[l][0] = g->gx[3*k+l];
+            gradpsi[l][1] = g->gy[3*k+l];
+        }
+        for (r = 0; r < q->n; r++) {
+            xq[r] = g->xq[r*g->Kloc+k];
+            yq[r] = g->yq[r*g->Kloc+k];
+        }
+        return;
+    }
+    dx1 = aloc[en[1]].x - aloc[en[0]].x;
+    dx2 = aloc[en[2]].x - aloc[en[0]].x;
+    dy1 = aloc[en[1]].y - aloc[en[0]].y;
+    dy2 = aloc[en[2]].y - aloc[en[0]].y;
+    detJ = dx1 * dy2 - dx2 * dy1;
+    *absdetJ = PetscAbsReal(detJ);
+    for (l = 0; l < 3; l++) {
+        gradpsi[l][0] = ( dy2 * dchi[l][0] - dy1 * dchi[l][1]) / detJ;
+        gradpsi[l][1] = (-dx2 * dchi[l][0] + dx1 * dchi[l][1]) / detJ;
+    }
+    for (r = 0; r < q->n; r++) {
+        xq[r] = aloc[en[0]].x + dx1 * q->xi[r] + dx2 * q->eta[r];
+        yq[r] = aloc[en[0]].y + dy1 * q->xi[r] + dy2 * q->eta[r];
+    }
+}
+
+// the nodes of element k: three vertices, then for P2 (if aem is not NULL)
+//   the three edge nodes; returns the number of nodes
+static PetscInt ElementNodes(const PetscInt *ae, const PetscInt *aem,
+                             PetscInt k, PetscInt en[6]) {
+    PetscInt  l;
+    for (l = 0; l < 3; l++)
+        en[l] = ae[3*k+l];
+    if (!aem)
+        return 3;
+    for (l = 0; l < 3; l++)
+        en[3+l] = aem[3*k+l];
+    return 6;
+}
+
+/* P2 basis on the reference element, with local nodes 0,1,2 at the
+vertices and 3,4,5 on the edges 01, 12, 20.  In barycentric coordinates
+z = (1-xi-eta, xi, eta), which are the P1 hat functions, phi_l =
+z_l (2 z_l - 1) and phi_{3+l} = 4 z_l z_{l+1}.  This computes phi_L and
+its gradient, using the hat function gradients from ElementGeometry(). */
+static void P2Basis(PetscReal xi, PetscReal eta, PetscReal gradpsi[3][2],
+                    PetscReal phi[6], PetscReal gradphi[6][2]) {
+    const PetscReal z[3] = {1.0 - xi - eta, xi, eta};
+    PetscInt        l, m, d;
+    for (l = 0; l < 3; l++) {
+        m = (l + 1) % 3;
+        phi[l] = z[l] * (2.0 * z[l] - 1.0);
+        phi[3+l] = 4.0 * z[l] * z[m];
+        for (d = 0; d < 2; d++) {
+            gradphi[l][d] = (4.0 * z[l] - 1.0) * gradpsi[l][d];
+            gradphi[3+l][d] = 4.0 * (z[m] * gradpsi[l][d] + z[l] * gradpsi[m][d]);
+        }
+    }
+}
+
 extern PetscErrorCode FillExact(Vec, unfemCtx*);
+extern PetscErrorCode FillDataCaches(unfemCtx*);
 extern PetscErrorCode FormFunction(SNES, Vec, Vec, void*);
 extern PetscErrorCode FormPicard(SNES, Vec, Mat, Mat, void*);
+extern PetscErrorCode FormNewton(SNES, Vec, Mat, Mat, void*);
 extern PetscErrorCode PreallocateAndSetNonzeros(Mat, unfemCtx*);
+extern PetscErrorCode FormShellJacobian(SNES, Vec, Mat, Mat, void*);
+extern PetscErrorCode ShellMult(Mat, Vec, Vec);
+extern PetscErrorCode ErrorIndicators(unfemCtx*, Vec, PetscReal*);
+extern PetscErrorCode AdaptMesh(unfemCtx*, PetscInt, PetscReal, PetscReal, Vec*);
 
 int main(int argc,char **argv) {
     PetscMPIInt size;
     PetscBool   viewmesh = PETSC_FALSE,
+                viewquality = PETSC_FALSE,
                 viewsoln = PETSC_FALSE,
+                viewxdmf = PETSC_FALSE,
                 noprealloc = PETSC_FALSE,
+                reorder = PETSC_FALSE,
+                cachegeom = PETSC_FALSE,
+                matfree = PETSC_FALSE,
+                colorelems = PETSC_FALSE,
+                gmg = PETSC_FALSE,
                 savepintbinary = PETSC_FALSE,
-                savepintmatlab = PETSC_FALSE;
+                savepintmatlab = PETSC_FALSE,
+                quadset = PETSC_FALSE,
+                neuset = PETSC_FALSE;
     char        root[256] = "", nodesname[256], issname[256], solnname[256],
+                umname[256] = "",
+                mshname[256] = "",
                 pintname[256] = "";
-    PetscInt    savepintlevel = -1, levels;
+    PetscInt    savepintlevel = -1, levels, refine = 0, lev, *Nlev = NULL,
+                structured = 0, amrsteps = 0;
     UM          mesh;
+    UMXDMF      xdmf;
+    UMQualityReport qr;
+    IS          *midparents = NULL;
     unfemCtx    user;
     SNES        snes;
     KSP         ksp;
     PC          pc;
     PCType      pctype;
-    Mat         A;
-    Vec         r, u, uexact;
-    PetscReal   err, h_max;
+    Mat         A, Ashell = NULL;
+    Vec         r, u, uexact, uinit = NULL;
+    PetscReal   err, h_max, amrtheta = 0.5, amrtol = 0.0;
 
     PetscCall(PetscInitialize(&argc,&argv,NULL,help));
 
     PetscCall(MPI_Comm_size(PETSC_COMM_WORLD,&size));
-    if (size != 1) {
-        SETERRQ(PETSC_COMM_SELF,1,"unfem only works on one MPI process");
-    }
 
     PetscCall(PetscLogStageRegister("Read mesh      ", &user.readstage));  //STRIP
     PetscCall(PetscLogStageRegister("Set-up         ", &user.setupstage));  //STRIP
@@ -85,10 +207,43 @@ int main(int argc,char **argv) {
 
     user.quaddegree = 1;
     user.solncase = 0;
+    user.newton = PETSC_FALSE;
+    user.batch = PETSC_FALSE;
+    user.p2 = PETSC_FALSE;
+    user.picardlag = 1;
+    user.jaccount = 0;
+    user.ujac = NULL;
+    user.vloc = NULL;
+    user.aq = NULL;
+    user.daq = NULL;
+    user.dfq = NULL;
+    user.gradu = NULL;
+    user.eoff = NULL;
+    user.doff = NULL;
+    user.neumannpts = 1;
+    user.gN = NULL;
     PetscOptionsBegin(PETSC_COMM_WORLD, "un_", "options for unfem", "");
+    PetscCall(PetscOptionsInt("-amr_steps",
+           "adapt the mesh by at most this many steps of error estimation and local refinement (newest-vertex bisection) before the final solve",
+           "unfem.c",amrsteps,&amrsteps,NULL));
+    PetscCall(PetscOptionsReal("-amr_theta",
+           "with -un_amr_steps, refine the fewest elements whose error indicators sum to this fraction of the total (bulk marking)",
+           "unfem.c",amrtheta,&amrtheta,NULL));
+    PetscCall(PetscOptionsReal("-amr_tol",
+           "with -un_amr_steps, stop adapting once the estimated error is at most this",
+           "unfem.c",amrtol,&amrtol,NULL));
+    PetscCall(PetscOptionsBool("-batch",
+           "evaluate residual in batches of elements, using batched coefficient functions",
+           "unfem.c",user.batch,&(user.batch),NULL));
+    PetscCall(PetscOptionsBool("-cache_geometry",
+           "compute element geometry once and reuse it in residual and Jacobian evaluations",
+           "unfem.c",cachegeom,&cachegeom,NULL));
     PetscCall(PetscOptionsInt("-case",
            "exact solution cases: 0=linear, 1=nonlinear, 2=nonhomoNeumann, 3=chapter3, 4=koch",
            "unfem.c",user.solncase,&(user.solncase),NULL));
+    PetscCall(PetscOptionsBool("-color_elements",
+           "color elements so that the residual element loop can use OpenMP threads within each color",
+           "unfem.c",colorelems,&colorelems,NULL));
     PetscCall(PetscOptionsString("-gamg_save_pint_binary",
            "filename under which to save interpolation operator (Mat) in PETSc binary format",
            "unfem.c",pintname,pintname,sizeof(pintname),&savepintbinary));
@@ -98,27 +253,107 @@ int main(int argc,char **argv) {
     PetscCall(PetscOptionsInt("-gamg_save_pint_level",
            "saved interpolation operator is between L-1 and L where this option sets L; defaults to finest levels",
            "unfem.c",savepintlevel,&savepintlevel,NULL));
+    PetscCall(PetscOptionsBool("-gmg",
+           "use geometric multigrid (PCMG) over the levels generated by -un_refine, with P1 interpolation and Galerkin coarse operators",
+           "unfem.c",gmg,&gmg,NULL));
+    PetscCall(PetscOptionsBool("-matfree",
+           "Jacobian is a matrix-free (MATSHELL) operator; preconditioner is built from the assembled Picard matrix",
+           "unfem.c",matfree,&matfree,NULL));
     PetscCall(PetscOptionsString("-mesh",
-           "file name root of mesh stored in PETSc binary with .vec,.is extensions",
+           "file name root of mesh stored in PETSc binary with .vec,.is extensions, or name of single .um mesh file, or name of Gmsh .msh file",
            "unfem.c",root,root,sizeof(root),NULL));
+    PetscCall(PetscOptionsInt("-neumann_pts",
+           "number of Gauss-Legendre points for the Neumann load on each boundary segment (= 1,...,6); default is 1, or 3 for P2",
+           "unfem.c",user.neumannpts,&(user.neumannpts),&neuset));
+    PetscCall(PetscOptionsBool("-newton",
+           "use the Newton Jacobian, including da/du and df/du terms, instead of the Picard matrix",
+           "unfem.c",user.newton,&(user.newton),NULL));
     PetscCall(PetscOptionsBool("-noprealloc",
            "do not perform preallocation before matrix assembly",
            "unfem.c",noprealloc,&noprealloc,NULL));
+    PetscCall(PetscOptionsBool("-p2",
+           "use P2 (quadratic) elements, adding a node on each edge; default quadrature degree is then 4",
+           "unfem.c",user.p2,&(user.p2),NULL));
+    PetscCall(PetscOptionsInt("-picard_lag",
+           "with -un_matfree, reassemble the Picard preconditioning matrix only every L Jacobian evaluations",
+           "unfem.c",user.picardlag,&(user.picardlag),NULL));
     PetscCall(PetscOptionsInt("-quaddegree",
-           "quadrature degree (1,2,3)",
-           "unfem.c",user.quaddegree,&(user.quaddegree),NULL));
+           "quadrature degree (1,...,10)",
+           "unfem.c",user.quaddegree,&(user.quaddegree),&quadset));
+    PetscCall(PetscOptionsInt("-refine",
+           "refine the mesh uniformly this many times, in memory, after reading it",
+           "unfem.c",refine,&refine,NULL));
+    PetscCall(PetscOptionsBool("-reorder",
+           "renumber nodes by reverse Cuthill-McKee and sort elements accordingly, for locality",
+           "unfem.c",reorder,&reorder,NULL));
+    PetscCall(PetscOptionsInt("-structured",
+           "instead of reading a mesh, create the M x M structured mesh of genstructured.py in memory; use with -un_case 3",
+           "unfem.c",structured,&structured,NULL));
     PetscCall(PetscOptionsBool("-view_mesh",
            "view loaded mesh (nodes and elements) at stdout",
            "unfem.c",viewmesh,&viewmesh,NULL));
+    PetscCall(PetscOptionsBool("-view_quality",
+           "print mesh quality report (angles, aspect ratios, bad elements, orphan nodes) at stdout",
+           "unfem.c",viewquality,&viewquality,NULL));
     PetscCall(PetscOptionsBool("-view_solution",
            "view solution u(x,y) to binary file; uses root name of mesh plus .soln\nsee petsc2tricontour.py to view graphically",
            "unfem.c",viewsoln,&viewsoln,NULL));
+    PetscCall(PetscOptionsBool("-view_xdmf",
+           "write mesh, solution u(x,y), and error (if known) to binary file root.bin, described by root.xmf\nopen root.xmf in ParaView to view graphically",
+           "unfem.c",viewxdmf,&viewxdmf,NULL));
     PetscOptionsEnd();
+    if (user.batch && colorelems) {
+        SETERRQ(PETSC_COMM_SELF,5,"-un_batch and -un_color_elements cannot be combined");
+    }
+    if (user.picardlag < 1) {
+        SETERRQ(PETSC_COMM_SELF,4,"-un_picard_lag must be positive");
+    }
+    if (refine < 0) {
+        SETERRQ(PETSC_COMM_SELF,6,"-un_refine must be nonnegative");
+    }
+    if (gmg && refine == 0) {
+        SETERRQ(PETSC_COMM_SELF,7,"-un_gmg requires -un_refine with at least one level");
+    }
+    if (user.p2 && (user.batch || user.newton || matfree || gmg)) {
+        SETERRQ(PETSC_COMM_SELF,8,"-un_p2 cannot be combined with -un_batch, -un_newton, -un_matfree, or -un_gmg");
+    }
+    if (user.p2 && !quadset) {
+        user.quaddegree = 4;  // P1 default of 1 is too low for quadratics
+    }
+    if (user.p2 && !neuset) {
+        user.neumannpts = 3;  // exact for P2 basis times quadratic g_N
+    }
+    if ((user.neumannpts < 1) || (user.neumannpts > MAXPTS)) {
+        SETERRQ(PETSC_COMM_SELF,13,"-un_neumann_pts must be 1,...,6");
+    }
+    if ((user.quaddegree < 1) || (user.quaddegree > MAXDEGREE_TRI)) {
+        SETERRQ(PETSC_COMM_SELF,9,"-un_quaddegree must be 1,...,10");
+    }
+    if (amrsteps < 0) {
+        SETERRQ(PETSC_COMM_SELF,10,"-un_amr_steps must be nonnegative");
+    }
+    if ((amrtheta <= 0.0) || (amrtheta > 1.0)) {
+        SETERRQ(PETSC_COMM_SELF,11,"-un_amr_theta must be in (0,1]");
+    }
+    if ((amrsteps > 0) && ((size > 1) || reorder || user.p2 || gmg)) {
+        SETERRQ(PETSC_COMM_SELF,12,"-un_amr_steps requires one process, and cannot be combined with -un_reorder, -un_p2, or -un_gmg");
+    }
 
     // determine filenames
+    if ((strlen(root) == 0) && (structured > 0)) {
+        strcpy(root, "structured");  // only used for output files
+    }
     if (strlen(root) == 0) {
         SETERRQ(PETSC_COMM_SELF,2,"no mesh name root given; rerun with '-un_mesh foo'");
     }
+    if ((strlen(root) > 3) && (strcmp(root + strlen(root) - 3,".um") == 0)) {
+        strcpy(umname, root);
+        root[strlen(root) - 3] = '\0';  // root is used for solution file
+    }
+    if ((strlen(root) > 4) && (strcmp(root + strlen(root) - 4,".msh") == 0)) {
+        strcpy(mshname, root);
+        root[strlen(root) - 4] = '\0';
+    }
     strcpy(nodesname, root);
     strncat(nodesname, ".vec", 5);
     strcpy(issname, root);
@@ -126,30 +361,42 @@ int main(int argc,char **argv) {
 
     // set source/boundary functions and exact solution
     user.a_fcn = &a_lin;
+    user.a_batch = &a_lin_batch;
+    user.dadu_fcn = &dadu_lin;
     user.f_fcn = &f_lin;
+    user.f_batch = &f_lin_batch;
+    user.dfdu_fcn = &dfdu_lin;
     user.uexact_fcn = &uexact_lin;
     user.gD_fcn = &gD_lin;
     user.gN_fcn = &gN_lin;
+    user.f_uindep = PETSC_TRUE;  // true for all f_fcn() in cases.h
     switch (user.solncase) {
         case 0 :
             break;
         case 1 :
             user.a_fcn = &a_nonlin;
+            user.a_batch = &a_nonlin_batch;
+            user.dadu_fcn = &dadu_nonlin;
             user.f_fcn = &f_nonlin;
+            user.f_batch = &f_nonlin_batch;
             break;
         case 2 :
             user.gN_fcn = &gN_linneu;
             break;
         case 3 :
             user.a_fcn = &a_square;
+            user.a_batch = &a_square_batch;
             user.f_fcn = &f_square;
+            user.f_batch = &f_square_batch;
             user.uexact_fcn = &uexact_square;
             user.gD_fcn = &gD_square;
             user.gN_fcn = NULL;  // seg fault if ever called
             break;
         case 4 :
             user.a_fcn = &a_koch;
+            user.a_batch = &a_koch_batch;
             user.f_fcn = &f_koch;
+            user.f_batch = &f_koch_batch;
             user.uexact_fcn = NULL;  // seg fault if ever called
             user.gD_fcn = &gD_koch;
             user.gN_fcn = NULL;  // seg fault if ever called
@@ -161,9 +408,66 @@ int main(int argc,char **argv) {
     PetscLogStagePush(user.readstage);
     // read mesh object of type UM
     PetscCall(UMInitialize(&mesh));
-    PetscCall(UMReadNodes(&mesh,nodesname));
-    PetscCall(UMReadISs(&mesh,issname));
+    if (structured > 0) {
+        // generate only the local part unless the whole mesh is modified below
+        PetscCall(UMCreateStructured(&mesh,structured,
+                                     (refine == 0) && (amrsteps == 0)
+                                     && !reorder && !user.p2));
+    } else if (strlen(umname) > 0) {
+        PetscCall(UMReadMeshFile(&mesh,umname));
+    } else if (strlen(mshname) > 0) {
+        PetscCall(UMReadGmsh(&mesh,mshname));
+    } else {
+        PetscCall(UMReadNodes(&mesh,nodesname));
+        PetscCall(UMReadISs(&mesh,issname));
+    }
+    // keep the refinement hierarchy for -un_gmg; Nlev[lev] is the number
+    //   of nodes on level lev, with 0 the mesh as read
+    if (gmg) {
+        PetscCall(PetscMalloc2(refine,&Nlev,refine,&midparents));
+    }
+    for (lev = 0; lev < refine; lev++) {
+        if (gmg) {
+            Nlev[lev] = mesh.N;
+            PetscCall(UMRefineUniform(&mesh,&(midparents[lev])));
+        } else {
+            PetscCall(UMRefineUniform(&mesh,NULL));
+        }
+    }
+    if (amrsteps > 0) {
+        user.mesh = &mesh;
+        PetscCall(AdaptMesh(&user,amrsteps,amrtheta,amrtol,&uinit));
+    }
+    if (reorder) {
+        PetscCall(UMReorder(&mesh));
+    }
+    if (user.p2) {
+        PetscCall(UMAddEdgeNodes(&mesh));
+    }
+    if (!mesh.l2g) {
+        PetscCall(UMDistribute(&mesh));
+    }
+    if (colorelems) {
+        PetscCall(UMColorElements(&mesh));
+    }
+    if (cachegeom) {
+        const Quad2DTri q = symmgauss[user.quaddegree-1];
+        PetscCall(UMComputeGeometry(&mesh,q.n,q.xi,q.eta));
+    }
     PetscCall(UMStats(&mesh, &h_max, NULL, NULL, NULL));
+    // always scan for bad elements; a consistently clockwise mesh is fine
+    //   because assembly uses |det J|, but mixed orientation means a tangle
+    PetscCall(UMQuality(&mesh,&qr));
+    if ((qr.duplicate > 0) || (qr.degenerate > 0)) {
+        SETERRQ(PETSC_COMM_WORLD,14,
+                "mesh has %d elements with repeated nodes and %d degenerate elements",
+                qr.duplicate,qr.degenerate);
+    }
+    if ((qr.negative > 0) && (qr.negative < mesh.K)) {
+        SETERRQ(PETSC_COMM_WORLD,14,
+                "mesh has %d of %d elements negatively-oriented (mixed orientation)",
+                qr.negative,mesh.K);
+    }
     user.mesh = &mesh;
     PetscLogStagePop();
 
@@ -172,29 +476,64 @@ int main(int argc,char **argv) {
         PetscCall(PetscViewerASCIIGetStdout(PETSC_COMM_WORLD,&stdoutviewer));
         PetscCall(UMViewASCII(&mesh,stdoutviewer));
     }
+    if (viewquality) {
+        PetscViewer stdoutviewer;
+        PetscCall(PetscViewerASCIIGetStdout(PETSC_COMM_WORLD,&stdoutviewer));
+        PetscCall(UMQualityView(&qr,stdoutviewer));
+    }
 
     PetscLogStagePush(user.setupstage);
 //STARTMAININITIAL
     // configure Vecs
     PetscCall(VecCreate(PETSC_COMM_WORLD,&r));
-    PetscCall(VecSetSizes(r,PETSC_DECIDE,mesh.N));
+    PetscCall(VecSetSizes(r,mesh.Nown,mesh.N));
     PetscCall(VecSetFromOptions(r));
     PetscCall(VecDuplicate(r,&u));
     PetscCall(VecSet(u,0.0));
+    if (uinit) {  // from AdaptMesh()
+        PetscCall(VecCopy(uinit,u));
+        PetscCall(VecDestroy(&uinit));
+    }
+    PetscCall(UMCreateLocalVec(&mesh,&(user.uloc)));
+    PetscCall(VecDuplicate(user.uloc,&(user.Floc)));
+    PetscCall(FillDataCaches(&user));
 
     // configure SNES: reset default KSP and PC
     PetscCall(SNESCreate(PETSC_COMM_WORLD,&snes));
     PetscCall(SNESSetFunction(snes,r,FormFunction,&user));
     PetscCall(SNESGetKSP(snes,&ksp));
-    PetscCall(KSPSetType(ksp,KSPCG));
+    PetscCall(KSPSetType(ksp,(user.newton) ? KSPGMRES : KSPCG));
     PetscCall(KSPGetPC(ksp,&pc));
-    PetscCall(PCSetType(pc,PCICC));
+    if (gmg) {
+        // finest level is refine; only its rows follow the distribution and
+        //   (if -un_reorder) the permutation of the mesh
+        PetscCall(PCSetType(pc,PCMG));
+        PetscCall(PCMGSetLevels(pc,refine+1,NULL));
+        PetscCall(PCMGSetGalerkin(pc,PC_MG_GALERKIN_BOTH));
+        for (lev = 1; lev <= refine; lev++) {
+            Mat P;
+            PetscCall(UMCreateRefinementInterpolation(Nlev[lev-1],midparents[lev-1],
+                          (lev == refine) ? mesh.perm : NULL,
+                          (lev == refine) ? mesh.Nown : PETSC_DECIDE,&P));
+            PetscCall(PCMGSetInterpolation(pc,lev,P));
+            PetscCall(MatDestroy(&P));
+            PetscCall(ISDestroy(&(midparents[lev-1])));
+        }
+        PetscCall(PetscFree2(Nlev,midparents));
+    } else if (size > 1)
+        PetscCall(PCSetType(pc,PCBJACOBI));
+    else
+        PetscCall(PCSetType(pc,(user.newton && !matfree) ? PCILU : PCICC));
 
-    // setup matrix for Picard iteration, including preallocation
+    // setup matrix for Picard iteration, including preallocation; rows
+    //   are owned nodes and entries are set using local node indices
     PetscCall(MatCreate(PETSC_COMM_WORLD,&A));
-    PetscCall(MatSetSizes(A,PETSC_DECIDE,PETSC_DECIDE,mesh.N,mesh.N));
+    PetscCall(MatSetSizes(A,mesh.Nown,mesh.Nown,mesh.N,mesh.N));
     PetscCall(MatSetFromOptions(A));
-    PetscCall(MatSetOption(A,MAT_SYMMETRIC,PETSC_TRUE));
+    if (!user.newton || matfree) {  // assembled Newton is not symmetric
+        PetscCall(MatSetOption(A,MAT_SYMMETRIC,PETSC_TRUE));
+    }
+    PetscCall(MatSetLocalToGlobalMapping(A,mesh.l2g,mesh.l2g));
     // Preallocation and setting the nonzero (sparsity) pattern is
     //   recommended; setting the pattern allows finite difference
     //   approximation of the Jacobian using coloring.  Option
@@ -204,9 +543,23 @@ int main(int argc,char **argv) {
     } else {
         PetscCall(PreallocateAndSetNonzeros(A,&user));
     }
-    // The following call-back is ignored under option -snes_fd or
+    // The following call-backs are ignored under option -snes_fd or
     //   -snes_fd_color.
-    PetscCall(SNESSetJacobian(snes,A,A,FormPicard,&user));
+    if (matfree) {
+        const PetscInt nq = symmgauss[user.quaddegree-1].n;
+        PetscCall(MatCreateShell(PETSC_COMM_WORLD,mesh.Nown,mesh.Nown,mesh.N,mesh.N,
+                                 &user,&Ashell));
+        PetscCall(MatShellSetOperation(Ashell,MATOP_MULT,(void(*)(void))ShellMult));
+        PetscCall(VecDuplicate(user.uloc,&(user.ujac)));
+        PetscCall(VecDuplicate(user.uloc,&(user.vloc)));
+        PetscCall(PetscMalloc4(nq*mesh.Kloc,&(user.aq),nq*mesh.Kloc,&(user.daq),
+                               nq*mesh.Kloc,&(user.dfq),2*mesh.Kloc,&(user.gradu)));
+        PetscCall(SNESSetJacobian(snes,Ashell,A,FormShellJacobian,&user));
+    } else if (user.newton) {
+        PetscCall(SNESSetJacobian(snes,A,A,FormNewton,&user));
+    } else {
+        PetscCall(SNESSetJacobian(snes,A,A,FormPicard,&user));
+    }
     PetscCall(SNESSetFromOptions(snes));
     PetscLogStagePop();  //STRIP
 
@@ -216,12 +569,16 @@ int main(int argc,char **argv) {
 //ENDMAININITIAL
     PetscLogStagePop();
 
-    // report if PC is GAMG
+    // report if PC is GAMG or MG
     PetscCall(PCGetType(pc,&pctype));
     if (strcmp(pctype,"gamg") == 0) {
         PetscCall(PCMGGetLevels(pc,&levels));
         PetscCall(PetscPrintf(PETSC_COMM_WORLD,
                "  PC is GAMG with %d levels\n",levels));
+    } else if (strcmp(pctype,"mg") == 0) {
+        PetscCall(PCMGGetLevels(pc,&levels));
+        PetscCall(PetscPrintf(PETSC_COMM_WORLD,
+               "  PC is MG with %d levels\n",levels));
     }
 
     // save Pint from GAMG if requested
@@ -257,11 +614,24 @@ int main(int argc,char **argv) {
         PetscCall(MatView(pint,viewer));
     }
 
+    // save mesh and solution in XDMF layout if requested; each process
+    //   writes its own part
+    if (viewxdmf) {
+        PetscCall(PetscPrintf(PETSC_COMM_WORLD,
+                   "writing mesh and solution in XDMF format to %s.xmf and %s.bin ...\n",
+                   root,root));
+        PetscCall(UMXDMFCreate(&mesh,root,&xdmf));
+        PetscCall(UMXDMFAppendField(&mesh,&xdmf,u,"u"));
+    }
+
     // if exact solution available, report numerical error
     if (user.uexact_fcn) {
         PetscCall(VecDuplicate(r,&uexact));
         PetscCall(FillExact(uexact,&user));
         PetscCall(VecAXPY(u,-1.0,uexact));    // u <- u + (-1.0) uexact
+        if (viewxdmf) {
+            PetscCall(UMXDMFAppendField(&mesh,&xdmf,u,"error"));
+        }
         PetscCall(VecNorm(u,NORM_INFINITY,&err));
         PetscCall(PetscPrintf(PETSC_COMM_WORLD,
                    "case %d result for N=%d nodes with h = %.3e: |u-u_ex|_inf = %.2e\n",
@@ -283,6 +653,15 @@ int main(int argc,char **argv) {
     }
 
     // clean-up
+    PetscCall(VecDestroy(&(user.uloc)));
+    PetscCall(VecDestroy(&(user.Floc)));
+    PetscCall(PetscFree2(user.gD,user.fq));
+    PetscCall(VecDestroy(&(user.gN)));
+    PetscCall(PetscFree4(user.aq,user.daq,user.dfq,user.gradu));
+    PetscCall(PetscFree2(user.eoff,user.doff));
+    PetscCall(VecDestroy(&(user.ujac)));
+    PetscCall(VecDestroy(&(user.vloc)));
+    PetscCall(MatDestroy(&Ashell));
     PetscCall(VecDestroy(&u));
     PetscCall(VecDestroy(&r));
     PetscCall(MatDestroy(&A));
@@ -298,7 +677,7 @@ PetscErrorCode FillExact(Vec uexact, unfemCtx *ctx) {
     PetscInt     i;
     PetscCall(UMGetNodeCoordArrayRead(ctx->mesh,&aloc));
     PetscCall(VecGetArray(uexact,&auexact));
-    for (i = 0; i < ctx->mesh->N; i++) {
+    for (i = 0; i < ctx->mesh->Nown; i++) {  // owned nodes are first locally
         auexact[i] = ctx->uexact_fcn(aloc[i].x,aloc[i].y);
     }
     PetscCall(VecRestoreArray(uexact,&auexact));
@@ -306,158 +685,803 @@ PetscErrorCode FillExact(Vec uexact, unfemCtx *ctx) {
     return 0;
 }
 
+// g_D, g_N, and (if possible) f do not depend on u, so evaluate them once;
+//   call after creating user->Floc, which is used as work space
+PetscErrorCode FillDataCaches(unfemCtx *user) {
+    UM               *mesh = user->mesh;
+    const Quad2DTri  q = symmgauss[user->quaddegree-1];
+    const Quad1D     g = gausslegendre[user->neumannpts-1];
+    const PetscInt   *ae, *abf, *ans, *ansm = NULL;
+    const Node       *aloc;
+    PetscInt         n, p, k, r, na, nb, nm;
+    PetscReal        *aF, dx, dy, t, gNq, absdetJ, gradpsi[3][2],
+                     xq[MAXPTS_TRI], yq[MAXPTS_TRI];
+
+    PetscCall(PetscMalloc2(mesh->Nloc,&(user->gD),
+                           (user->f_uindep) ? q.n * mesh->Kloc : 0,&(user->fq)));
+    PetscCall(UMGetNodeCoordArrayRead(mesh,&aloc));
+    PetscCall(ISGetIndices(mesh->bf,&abf));
+    for (n = 0; n < mesh->Nloc; n++)
+        user->gD[n] = (abf[n] == 2) ? user->gD_fcn(aloc[n].x,aloc[n].y) : 0.0;
+
+    // Neumann load, summed into a global Vec which FormFunction() subtracts;
+    //   on segment (na,nb), parameterized by t in [0,1], the P1 basis
+    //   functions are 1-t and t, and the P2 ones are (1-t)(1-2t), t(2t-1),
+    //   and 4t(1-t) at the edge node nm
+    if (mesh->P > 0) {
+        PetscCall(VecSet(user->Floc,0.0));
+        PetscCall(VecGetArray(user->Floc,&aF));
+        if (mesh->Ploc > 0) {
+            PetscCall(ISGetIndices(mesh->ns,&ans));
+            if (user->p2) {
+                PetscCall(ISGetIndices(mesh->nsm,&ansm));
+            }
+            for (p = 0; p < mesh->Ploc; p++) {
+                na = ans[2*p+0];  nb = ans[2*p+1];  // end nodes of segment
+                dx = aloc[nb].x-aloc[na].x;  dy = aloc[nb].y-aloc[na].y;
+                for (r = 0; r < g.n; r++) {
+                    t = 0.5 * (g.xi[r] + 1.0);
+                    gNq = 0.5 * sqrt(dx * dx + dy * dy) * g.w[r]
+                          * user->gN_fcn(aloc[na].x + t * dx,aloc[na].y + t * dy);
+                    if (ansm) {
+                        nm = ansm[p];
+                        aF[na] += gNq * (1.0 - t) * (1.0 - 2.0 * t);
+                        aF[nb] += gNq * t * (2.0 * t - 1.0);
+                        aF[nm] += gNq * 4.0 * t * (1.0 - t);
+                    } else {
+                        aF[na] += gNq * (1.0 - t);
+                        aF[nb] += gNq * t;
+                    }
+                }
+            }
+            if (ansm) {
+                PetscCall(ISRestoreIndices(mesh->nsm,&ansm));
+            }
+            PetscCall(ISRestoreIndices(mesh->ns,&ans));
+        }
+        for (n = 0; n < mesh->Nloc; n++)  // no load at Dirichlet nodes
+            if (abf[n] == 2)
+                aF[n] = 0.0;
+        PetscCall(VecRestoreArray(user->Floc,&aF));
+        PetscCall(VecCreate(PETSC_COMM_WORLD,&(user->gN)));
+        PetscCall(VecSetSizes(user->gN,mesh->Nown,mesh->N));
+        PetscCall(VecSetFromOptions(user->gN));
+        PetscCall(VecSet(user->gN,0.0));
+        PetscCall(UMLocalToGlobal(mesh,user->Floc,ADD_VALUES,user->gN));
+    }
+    PetscCall(ISRestoreIndices(mesh->bf,&abf));
+    if (user->f_uindep) {
+        PetscCall(ISGetIndices(mesh->e,&ae));
+        for (k = 0; k < mesh->Kloc; k++) {
+            ElementGeometry(mesh,&q,k,ae+3*k,aloc,&absdetJ,gradpsi,xq,yq);
+            for (r = 0; r < q.n; r++)
+                user->fq[r*mesh->Kloc+k] = user->f_fcn(0.0,xq[r],yq[r]);
+        }
+        PetscCall(ISRestoreIndices(mesh->e,&ae));
+    }
+    PetscCall(UMRestoreNodeCoordArrayRead(mesh,&aloc));
+    return 0;
+}
+
 PetscReal InnerProd(const PetscReal V[2], const PetscReal W[2]) {
     return V[0] * W[0] + V[1] * W[1];
 }
 
+
+#define UNFEM_BATCH 8
+
+/* Residual contributions from the UNFEM_BATCH elements starting at k0.
+Data for the batch is gathered into arrays indexed by element within the
+batch (structure of arrays), so loops over j below have fixed length and
+independent iterations and can be vectorized.  The coefficients are
+evaluated by one call each to a_batch() and f_batch(). */
+static void ElementResidualBatch(unfemCtx *user, const Quad2DTri *q,
+                                 PetscReal psi[3][MAXPTS_TRI],
+                                 PetscInt k0, const PetscInt *ae,
+                                 const PetscInt *abf, const Node *aloc,
+                                 const PetscReal *au, PetscReal *aF) {
+    const PetscInt   B = UNFEM_BATCH, K = user->mesh->Kloc;
+    const UMGeometry *g = user->mesh->geom;
+    const PetscInt   *en;
+    PetscInt         j, l, r;
+    PetscReal        x0[UNFEM_BATCH], y0[UNFEM_BATCH], dx1[UNFEM_BATCH],
+                     dx2[UNFEM_BATCH], dy1[UNFEM_BATCH], dy2[UNFEM_BATCH],
+                     absdetJ[UNFEM_BATCH], gx[3][UNFEM_BATCH],
+                     gy[3][UNFEM_BATCH], un[3][UNFEM_BATCH],
+                     gux[UNFEM_BATCH], guy[UNFEM_BATCH],
+                     uq[MAXPTS_TRI*UNFEM_BATCH], xq[MAXPTS_TRI*UNFEM_BATCH],
+                     yq[MAXPTS_TRI*UNFEM_BATCH], aq[MAXPTS_TRI*UNFEM_BATCH],
+                     fq[MAXPTS_TRI*UNFEM_BATCH], res[3][UNFEM_BATCH],
+                     detJ, ip, sum;
+
+    // gather nodal values
+    for (j = 0; j < B; j++) {
+        en = ae + 3*(k0+j);
+        for (l = 0; l < 3; l++)
+            un[l][j] = (abf[en[l]] == 2) ? user->gD[en[l]] : au[en[l]];
+    }
+    // geometry
+    if (g) {
+        for (j = 0; j < B; j++) {
+            absdetJ[j] = g->absdetJ[k0+j];
+            for (l = 0; l < 3; l++) {
+                gx[l][j] = g->gx[3*(k0+j)+l];
+                gy[l][j] = g->gy[3*(k0+j)+l];
+            }
+        }
+        for (r = 0; r < q->n; r++) {
+            for (j = 0; j < B; j++) {
+                xq[r*B+j] = g->xq[r*K+k0+j];
+                yq[r*B+j] = g->yq[r*K+k0+j];
+            }
+        }
+    } else {
+        for (j = 0; j < B; j++) {
+            en = ae + 3*(k0+j);
+            x0[j]  = aloc[en[0]].x;
+            y0[j]  = aloc[en[0]].y;
+            dx1[j] = aloc[en[1]].x - x0[j];
+            dx2[j] = aloc[en[2]].x - x0[j];
+            dy1[j] = aloc[en[1]].y - y0[j];
+            dy2[j] = aloc[en[2]].y - y0[j];
+        }
+        for (j = 0; j < B; j++) {
+            detJ = dx1[j] * dy2[j] - dx2[j] * dy1[j];
+            absdetJ[j] = PetscAbsReal(detJ);
+            for (l = 0; l < 3; l++) {
+                gx[l][j] = ( dy2[j] * dchi[l][0] - dy1[j] * dchi[l][1]) / detJ;
+                gy[l][j] = (-dx2[j] * dchi[l][0] + dx1[j] * dchi[l][1]) / detJ;
+            }
+        }
+        for (r = 0; r < q->n; r++) {
+            for (j = 0; j < B; j++) {
+                xq[r*B+j] = x0[j] + dx1[j] * q->xi[r] + dx2[j] * q->eta[r];
+                yq[r*B+j] = y0[j] + dy1[j] * q->xi[r] + dy2[j] * q->eta[r];
+            }
+        }
+    }
+    // grad u on elements, and u at quadrature points
+    for (j = 0; j < B; j++) {
+        gux[j] = un[0][j] * gx[0][j] + un[1][j] * gx[1][j] + un[2][j] * gx[2][j];
+        guy[j] = un[0][j] * gy[0][j] + un[1][j] * gy[1][j] + un[2][j] * gy[2][j];
+    }
+    for (r = 0; r < q->n; r++)
+        for (j = 0; j < B; j++)
+            uq[r*B+j] = un[0][j] * psi[0][r] + un[1][j] * psi[1][r]
+                        + un[2][j] * psi[2][r];
+    // coefficients at quadrature points
+    user->a_batch(q->n*B,uq,xq,yq,aq);
+    if (user->f_uindep) {
+        for (r = 0; r < q->n; r++)
+            for (j = 0; j < B; j++)
+                fq[r*B+j] = user->fq[r*K+k0+j];
+    } else
+        user->f_batch(q->n*B,uq,xq,yq,fq);
+    // residual contributions
+    for (l = 0; l < 3; l++) {
+        for (j = 0; j < B; j++) {
+            ip = gux[j] * gx[l][j] + guy[j] * gy[l][j];
+            sum = 0.0;
+            for (r = 0; r < q->n; r++)
+                sum += q->w[r] * ( aq[r*B+j] * ip - fq[r*B+j] * psi[l][r] );
+            res[l][j] = absdetJ[j] * sum;
+        }
+    }
+    // scatter to non-Dirichlet nodes
+    for (j = 0; j < B; j++) {
+        en = ae + 3*(k0+j);
+        for (l = 0; l < 3; l++)
+            if (abf[en[l]] != 2)
+                aF[en[l]] += res[l][j];
+    }
+}
+
+/* Residual contributions from element k, added into aF at its
+non-Dirichlet nodes.  Only aF is written, so elements which share no nodes
+can be handled concurrently.  The number of quadrature points nq equals
+q->n; it is an argument so that the per-rule versions below can fix it. */
+static inline void ElementResidual(const unfemCtx *user, const Quad2DTri *q,
+                                   const PetscInt nq, PetscInt k,
+                                   const PetscInt *ae, const PetscInt *abf,
+                                   const Node *aloc, const PetscReal *au,
+                                   PetscReal *aF) {
+    const PetscInt  *en;
+    PetscInt        l, r;
+    PetscReal       unode[3], gradu[2], gradpsi[3][2], uquad[MAXPTS_TRI],
+                    aquad[MAXPTS_TRI], fquad[MAXPTS_TRI], xq[MAXPTS_TRI],
+                    yq[MAXPTS_TRI], absdetJ, psi, ip, sum;
+
+    // element geometry and hat function gradients
+    en = ae + 3*k;  // en[0], en[1], en[2] are nodes of element k
+    ElementGeometry(user->mesh,q,k,en,aloc,&absdetJ,gradpsi,xq,yq);
+    // u and grad u on element
+    gradu[0] = 0.0;
+    gradu[1] = 0.0;
+    for (l = 0; l < 3; l++) {
+        if (abf[en[l]] == 2)  // enforces symmetry
+            unode[l] = user->gD[en[l]];
+        else
+            unode[l] = au[en[l]];
+        gradu[0] += unode[l] * gradpsi[l][0];
+        gradu[1] += unode[l] * gradpsi[l][1];
+    }
+    // function values at quadrature points on element
+    for (r = 0; r < nq; r++) {
+        uquad[r] = eval(unode,q->xi[r],q->eta[r]);
+        aquad[r] = user->a_fcn(uquad[r],xq[r],yq[r]);
+        fquad[r] = (user->f_uindep) ? user->fq[r*user->mesh->Kloc+k]
+                                    : user->f_fcn(uquad[r],xq[r],yq[r]);
+    }
+    // residual contribution for each non-Dirichlet node of element
+    for (l = 0; l < 3; l++) {
+        if (abf[en[l]] != 2) {
+            sum = 0.0;
+            for (r = 0; r < nq; r++) {
+                psi = chi(l,q->xi[r],q->eta[r]);
+                ip  = InnerProd(gradu,gradpsi[l]);
+                sum += q->w[r] * ( aquad[r] * ip - fquad[r] * psi );
+            }
+            aF[en[l]] += absdetJ * sum;
+        }
+    }
+}
+
+/* Versions of ElementResidual() with the number of quadrature points
+fixed at compile time, one for each rule in symmgauss[], so the compiler can
+unroll the loops over quadrature points.  residualkernel[d-1] is for
+-un_quaddegree d; FormFunction() selects one before looping over elements. */
+typedef void (*ElementResidualFcn)(const unfemCtx*, const Quad2DTri*,
+                                   PetscInt, const PetscInt*, const PetscInt*,
+                                   const Node*, const PetscReal*, PetscReal*);
+
+#define ELEMENTRESIDUAL(NQ) \
+static void ElementResidual_##NQ(const unfemCtx *user, const Quad2DTri *q, \
+                                 PetscInt k, const PetscInt *ae, \
+                                 const PetscInt *abf, const Node *aloc, \
+                                 const PetscReal *au, PetscReal *aF) { \
+    ElementResidual(user,q,NQ,k,ae,abf,aloc,au,aF); \
+}
+ELEMENTRESIDUAL(1)
+ELEMENTRESIDUAL(3)
+ELEMENTRESIDUAL(4)
+ELEMENTRESIDUAL(6)
+ELEMENTRESIDUAL(7)
+ELEMENTRESIDUAL(12)
+ELEMENTRESIDUAL(13)
+ELEMENTRESIDUAL(16)
+ELEMENTRESIDUAL(19)
+ELEMENTRESIDUAL(25)
+
+static const ElementResidualFcn residualkernel[MAXDEGREE_TRI]
+    = {ElementResidual_1,  ElementResidual_3,  ElementResidual_4,
+       ElementResidual_6,  ElementResidual_7,  ElementResidual_12,
+       ElementResidual_13, ElementResidual_16, ElementResidual_19,
+       ElementResidual_25};
+
+/* As ElementResidual(), but for P2 elements, which have six nodes. */
+static void ElementResidualP2(const unfemCtx *user, const Quad2DTri *q,
+                              PetscInt k, const PetscInt *ae,
+                              const PetscInt *aem, const PetscInt *abf,
+                              const Node *aloc, const PetscReal *au,
+                              PetscReal *aF) {
+    PetscInt   en[6], l, r;
+    PetscReal  unode[6], gradpsi[3][2], phi[6], gradphi[6][2], res[6],
+               xq[MAXPTS_TRI], yq[MAXPTS_TRI], gradu[2], absdetJ, uquad,
+               aquad, fquad;
+
+    ElementNodes(ae,aem,k,en);
+    ElementGeometry(user->mesh,q,k,en,aloc,&absdetJ,gradpsi,xq,yq);
+    for (l = 0; l < 6; l++) {
+        unode[l] = (abf[en[l]] == 2) ? user->gD[en[l]] : au[en[l]];
+        res[l] = 0.0;
+    }
+    // grad u varies over the element, so is evaluated at quadrature points
+    for (r = 0; r < q->n; r++) {
+        P2Basis(q->xi[r],q->eta[r],gradpsi,phi,gradphi);
+        uquad = 0.0;
+        gradu[0] = 0.0;
+        gradu[1] = 0.0;
+        for (l = 0; l < 6; l++) {
+            uquad += unode[l] * phi[l];
+            gradu[0] += unode[l] * gradphi[l][0];
+            gradu[1] += unode[l] * gradphi[l][1];
+        }
+        aquad = user->a_fcn(uquad,xq[r],yq[r]);
+        fquad = (user->f_uindep) ? user->fq[r*user->mesh->Kloc+k]
+                                 : user->f_fcn(uquad,xq[r],yq[r]);
+        for (l = 0; l < 6; l++)
+            res[l] += q->w[r] * ( aquad * InnerProd(gradu,gradphi[l])
+                                  - fquad * phi[l] );
+    }
+    for (l = 0; l < 6; l++)
+        if (abf[en[l]] != 2)
+            aF[en[l]] += absdetJ * res[l];
+}
+
 //STARTRESIDUAL
 PetscErrorCode FormFunction(SNES snes, Vec u, Vec F, void *ctx) {
     unfemCtx         *user = (unfemCtx*)ctx;
     const Quad2DTri  q = symmgauss[user->quaddegree-1];
-    const PetscInt   *ae, *ans, *abf, *en;
+    const ElementResidualFcn elemres = residualkernel[user->quaddegree-1];
+    const PetscInt   *ae, *abf, *aem = NULL;
     const Node       *aloc;
     const PetscReal  *au;
-    PetscInt         p, na, nb, k, l, r;
-    PetscReal        *aF, unode[3], gradu[2], gradpsi[3][2], uquad[4],
-                     aquad[4], fquad[4], dx, dy, dx1, dx2, dy1, dy2,
-                     detJ, ls, xmid, ymid, sint, xx, yy, psi, ip, sum;
+    PetscInt         n, k, kbatch = 0, l, r, c, i;
+    PetscReal        *aF, psiq[3][MAXPTS_TRI];
 
     PetscLogStagePush(user->resstage);  //STRIP
-    PetscCall(VecSet(F,0.0));
-    PetscCall(VecGetArray(F,&aF));
+    // local residual is summed into global F, including ghost node values
+    PetscCall(UMGlobalToLocal(user->mesh,u,user->uloc));
+    PetscCall(VecSet(user->Floc,0.0));
+    PetscCall(VecGetArray(user->Floc,&aF));
     PetscCall(UMGetNodeCoordArrayRead(user->mesh,&aloc));
     PetscCall(ISGetIndices(user->mesh->bf,&abf));
 
-    // Neumann boundary segment contributions (if any)
-    if (user->mesh->P > 0) {
-        PetscCall(ISGetIndices(user->mesh->ns,&ans));
-        for (p = 0; p < user->mesh->P; p++) {
-            na = ans[2*p+0];  nb = ans[2*p+1];  // end nodes of segment
-            dx = aloc[na].x-aloc[nb].x;  dy = aloc[na].y-aloc[nb].y;
-            ls = sqrt(dx * dx + dy * dy);  // length of segment
-            // midpoint rule; psi_na=psi_nb=0.5 at midpoint of segment
-            xmid = 0.5*(aloc[na].x+aloc[nb].x);
-            ymid = 0.5*(aloc[na].y+aloc[nb].y);
-            sint = 0.5 * ls * user->gN_fcn(xmid,ymid);
-            // nodes could be Dirichlet
-            if (abf[na] != 2)
-                aF[na] -= sint;
-            if (abf[nb] != 2)
-                aF[nb] -= sint;
-        }
-        PetscCall(ISRestoreIndices(user->mesh->ns,&ans));
-    }
-
-    // element contributions and Dirichlet node residuals
-    PetscCall(VecGetArrayRead(u,&au));
+    // element contributions; with -un_batch, full batches first, and then
+    //   the remaining elements one at a time
+    PetscCall(VecGetArrayRead(user->uloc,&au));
     PetscCall(ISGetIndices(user->mesh->e,&ae));
-    for (k = 0; k < user->mesh->K; k++) {
-        // element geometry and hat function gradients
-        en = ae + 3*k;  // en[0], en[1], en[2] are nodes of element k
-        dx1 = aloc[en[1]].x - aloc[en[0]].x;
-        dx2 = aloc[en[2]].x - aloc[en[0]].x;
-        dy1 = aloc[en[1]].y - aloc[en[0]].y;
-        dy2 = aloc[en[2]].y - aloc[en[0]].y;
-        detJ = dx1 * dy2 - dx2 * dy1;
-        for (l = 0; l < 3; l++) {
-            gradpsi[l][0] = ( dy2 * dchi[l][0] - dy1 * dchi[l][1]) / detJ;
-            gradpsi[l][1] = (-dx2 * dchi[l][0] + dx1 * dchi[l][1]) / detJ;
+    if (user->p2) {
+        PetscCall(ISGetIndices(user->mesh->em,&aem));
+    }
+    if (user->batch) {
+        for (l = 0; l < 3; l++)
+            for (r = 0; r < q.n; r++)
+                psiq[l][r] = chi(l,q.xi[r],q.eta[r]);
+        for (kbatch = 0; kbatch + UNFEM_BATCH <= user->mesh->Kloc; kbatch += UNFEM_BATCH)
+            ElementResidualBatch(user,&q,psiq,kbatch,ae,abf,aloc,au,aF);
+    }
+    if (user->mesh->colorptr) {
+        // elements of one color share no nodes, so threads do not collide
+        for (c = 0; c < user->mesh->ncolors; c++) {
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static)
+#endif
+            for (i = user->mesh->colorptr[c]; i < user->mesh->colorptr[c+1]; i++) {
+                if (aem)
+                    ElementResidualP2(user,&q,user->mesh->colorelems[i],ae,aem,abf,aloc,au,aF);
+                else
+                    elemres(user,&q,user->mesh->colorelems[i],ae,abf,aloc,au,aF);
+            }
         }
-        // u and grad u on element
+    } else if (aem) {
+        for (k = 0; k < user->mesh->Kloc; k++)
+            ElementResidualP2(user,&q,k,ae,aem,abf,aloc,au,aF);
+    } else {
+        for (k = kbatch; k < user->mesh->Kloc; k++)
+            elemres(user,&q,k,ae,abf,aloc,au,aF);
+    }
+    if (aem) {
+        PetscCall(ISRestoreIndices(user->mesh->em,&aem));
+    }
+    PetscCall(ISRestoreIndices(user->mesh->e,&ae));
+
+    // Dirichlet node residuals; set only by the owning process
+    for (n = 0; n < user->mesh->Nown; n++) {
+        if (abf[n] == 2)
+            aF[n] = au[n] - user->gD[n];
+    }
+
+    PetscCall(VecRestoreArrayRead(user->uloc,&au));
+    PetscCall(ISRestoreIndices(user->mesh->bf,&abf));
+    PetscCall(UMRestoreNodeCoordArrayRead(user->mesh,&aloc));
+    PetscCall(VecRestoreArray(user->Floc,&aF));
+    PetscCall(VecSet(F,0.0));
+    PetscCall(UMLocalToGlobal(user->mesh,user->Floc,ADD_VALUES,F));
+    if (user->gN) {  // Neumann load; see FillDataCaches()
+        PetscCall(VecAXPY(F,-1.0,user->gN));
+    }
+    PetscLogStagePop();  //STRIP
+    return 0;
+}
+//ENDRESIDUAL
+
+
+/* Residual-based a posteriori error indicators for P1 elements, computed by
+the same element loop as FormFunction():
+    eta_k^2 = h_k^2 ||f||_k^2 + 1/2 sum_{E interior} |E|^2 [a grad u . n]_E^2
+                              + sum_{E Neumann} |E|^2 (a grad u . n - g_N)^2
+where h_k is the longest side of element k and [.]_E is the jump in the
+normal flux across edge E, with a(u) and g_N at the midpoint of E.  On P1
+elements div(a grad u) is zero for constant a, so the element residual is
+f alone.  Dirichlet edges contribute nothing.  On return eta2[k] is eta_k^2
+for the owned elements; see UMElementEdges() for the whole-mesh restriction. */
+PetscErrorCode ErrorIndicators(unfemCtx *user, Vec u, PetscReal *eta2) {
+    UM               *mesh = user->mesh;
+    const Quad2DTri  q = symmgauss[user->quaddegree-1];
+    const PetscInt   *ae, *abf, *ans, *en;
+    const Node       *aloc;
+    const PetscReal  *au;
+    PetscInt         NE, *eedge, *nsedge, *ecount, k, l, p, r, j, na, nb, nc;
+    PetscReal        *jump, *elen, unode[3], gradu[2], gradpsi[3][2],
+                     xq[MAXPTS_TRI], yq[MAXPTS_TRI], absdetJ, fquad, fsq, hk,
+                     dx, dy, len, nx, ny;
+
+    PetscCall(UMElementEdges(mesh,&NE,&eedge,&nsedge));
+    PetscCall(PetscCalloc3(NE,&jump,NE,&elen,NE,&ecount));
+    PetscCall(UMGlobalToLocal(mesh,u,user->uloc));
+    PetscCall(VecGetArrayRead(user->uloc,&au));
+    PetscCall(UMGetNodeCoordArrayRead(mesh,&aloc));
+    PetscCall(ISGetIndices(mesh->bf,&abf));
+    PetscCall(ISGetIndices(mesh->e,&ae));
+    for (k = 0; k < mesh->Kloc; k++) {
+        en = ae + 3*k;
+        ElementGeometry(mesh,&q,k,en,aloc,&absdetJ,gradpsi,xq,yq);
         gradu[0] = 0.0;
         gradu[1] = 0.0;
         for (l = 0; l < 3; l++) {
-            if (abf[en[l]] == 2)  // enforces symmetry
-                unode[l] = user->gD_fcn(aloc[en[l]].x,aloc[en[l]].y);
-            else
-                unode[l] = au[en[l]];
+            unode[l] = (abf[en[l]] == 2) ? user->gD[en[l]] : au[en[l]];
             gradu[0] += unode[l] * gradpsi[l][0];
             gradu[1] += unode[l] * gradpsi[l][1];
         }
-        // function values at quadrature points on element
+        fsq = 0.0;
         for (r = 0; r < q.n; r++) {
-            uquad[r] = eval(unode,q.xi[r],q.eta[r]);
-            xx = aloc[en[0]].x + dx1 * q.xi[r] + dx2 * q.eta[r];
-            yy = aloc[en[0]].y + dy1 * q.xi[r] + dy2 * q.eta[r];
-            aquad[r] = user->a_fcn(uquad[r],xx,yy);
-            fquad[r] = user->f_fcn(uquad[r],xx,yy);
+            fquad = (user->f_uindep) ? user->fq[r*mesh->Kloc+k]
+                        : user->f_fcn(eval(unode,q.xi[r],q.eta[r]),xq[r],yq[r]);
+            fsq += q.w[r] * fquad * fquad;
         }
-        // residual contribution for each node of element
+        // outward normal flux on each edge; the jump on an interior edge is
+        //   the sum of the two outward fluxes
+        hk = 0.0;
         for (l = 0; l < 3; l++) {
-            if (abf[en[l]] == 2) { // set Dirichlet residual
-                xx = aloc[en[l]].x;   yy = aloc[en[l]].y;
-                aF[en[l]] = au[en[l]] - user->gD_fcn(xx,yy);
-            } else {
-                sum = 0.0;
-                for (r = 0; r < q.n; r++) {
-                    psi = chi(l,q.xi[r],q.eta[r]);
-                    ip  = InnerProd(gradu,gradpsi[l]);
-                    sum += q.w[r] * ( aquad[r] * ip - fquad[r] * psi );
+            na = en[l];  nb = en[(l+1)%3];  nc = en[(l+2)%3];
+            dx = aloc[nb].x - aloc[na].x;  dy = aloc[nb].y - aloc[na].y;
+            len = PetscSqrtReal(dx * dx + dy * dy);
+            hk = PetscMax(hk,len);
+            nx = dy / len;  ny = - dx / len;
+            if ((aloc[nc].x - aloc[na].x) * nx + (aloc[nc].y - aloc[na].y) * ny > 0.0) {
+                nx = - nx;  ny = - ny;
+            }
+            j = eedge[3*k+l];
+            jump[j] += user->a_fcn(0.5 * (unode[l] + unode[(l+1)%3]),
+                                   0.5 * (aloc[na].x + aloc[nb].x),
+                                   0.5 * (aloc[na].y + aloc[nb].y))
+                       * (gradu[0] * nx + gradu[1] * ny);
+            elen[j] = len;
+            ecount[j]++;
+        }
+        eta2[k] = hk * hk * absdetJ * fsq;
+    }
+    // on a Neumann edge the jump is against g_N; ecount = -1 marks these
+    if (mesh->Ploc > 0) {
+        PetscCall(ISGetIndices(mesh->ns,&ans));
+        for (p = 0; p < mesh->Ploc; p++) {
+            na = ans[2*p+0];  nb = ans[2*p+1];
+            j = nsedge[p];
+            jump[j] -= user->gN_fcn(0.5 * (aloc[na].x + aloc[nb].x),
+                                    0.5 * (aloc[na].y + aloc[nb].y));
+            ecount[j] = -1;
+        }
+        PetscCall(ISRestoreIndices(mesh->ns,&ans));
+    }
+    for (k = 0; k < mesh->Kloc; k++) {
+        for (l = 0; l < 3; l++) {
+            j = eedge[3*k+l];
+            if (ecount[j] == 2)
+                eta2[k] += 0.5 * elen[j] * elen[j] * jump[j] * jump[j];
+            else if (ecount[j] == -1)
+                eta2[k] += elen[j] * elen[j] * jump[j] * jump[j];
+        }
+    }
+    PetscCall(ISRestoreIndices(mesh->e,&ae));
+    PetscCall(ISRestoreIndices(mesh->bf,&abf));
+    PetscCall(UMRestoreNodeCoordArrayRead(mesh,&aloc));
+    PetscCall(VecRestoreArrayRead(user->uloc,&au));
+    PetscCall(PetscFree3(jump,elen,ecount));
+    PetscCall(PetscFree(eedge));
+    PetscCall(PetscFree(nsedge));
+    return 0;
+}
+
+
+/* Picard element matrix for element k:  Ke[l][m] = int a(u) grad psi_m .
+grad psi_l  for all local nodes l,m of the element, Dirichlet or not.  As
+for ElementResidual(), nq = q->n is fixed in the per-rule versions below. */
+static inline void ElementPicard(const unfemCtx *user, const Quad2DTri *q,
+                                 const PetscInt nq, PetscInt k,
+                                 const PetscInt *ae, const PetscInt *abf,
+                                 const Node *aloc, const PetscReal *au,
+                                 PetscReal Ke[3][3]) {
+    const PetscInt  *en;
+    PetscReal       unode[3], gradpsi[3][2], uquad[MAXPTS_TRI], aquad[MAXPTS_TRI],
+                    xq[MAXPTS_TRI], yq[MAXPTS_TRI], absdetJ, sum;
+    PetscInt        l, m, r;
+
+    en = ae + 3*k;  // en[0], en[1], en[2] are nodes of element k
+    // geometry of element
+    ElementGeometry(user->mesh,q,k,en,aloc,&absdetJ,gradpsi,xq,yq);
+    // u on element
+    for (l = 0; l < 3; l++) {
+        if (abf[en[l]] == 2)
+            unode[l] = user->gD[en[l]];
+        else
+            unode[l] = au[en[l]];
+    }
+    // function values at quadrature points on element
+    for (r = 0; r < nq; r++) {
+        uquad[r] = eval(unode,q->xi[r],q->eta[r]);
+        aquad[r] = user->a_fcn(uquad[r],xq[r],yq[r]);
+    }
+    for (l = 0; l < 3; l++) {
+        for (m = 0; m < 3; m++) {
+            sum = 0.0;
+            for (r = 0; r < nq; r++)
+                sum += q->w[r] * aquad[r] * InnerProd(gradpsi[l],gradpsi[m]);
+            Ke[l][m] = absdetJ * sum;
+        }
+    }
+}
+
+typedef void (*ElementPicardFcn)(const unfemCtx*, const Quad2DTri*,
+                                 PetscInt, const PetscInt*, const PetscInt*,
+                                 const Node*, const PetscReal*,
+                                 PetscReal[3][3]);
+
+#define ELEMENTPICARD(NQ) \
+static void ElementPicard_##NQ(const unfemCtx *user, const Quad2DTri *q, \
+                               PetscInt k, const PetscInt *ae, \
+                               const PetscInt *abf, const Node *aloc, \
+                               const PetscReal *au, PetscReal Ke[3][3]) { \
+    ElementPicard(user,q,NQ,k,ae,abf,aloc,au,Ke); \
+}
+ELEMENTPICARD(1)
+ELEMENTPICARD(3)
+ELEMENTPICARD(4)
+ELEMENTPICARD(6)
+ELEMENTPICARD(7)
+ELEMENTPICARD(12)
+ELEMENTPICARD(13)
+ELEMENTPICARD(16)
+ELEMENTPICARD(19)
+ELEMENTPICARD(25)
+
+// picardkernel[d-1] is for -un_quaddegree d; see residualkernel[]
+static const ElementPicardFcn picardkernel[MAXDEGREE_TRI]
+    = {ElementPicard_1,  ElementPicard_3,  ElementPicard_4,
+       ElementPicard_6,  ElementPicard_7,  ElementPicard_12,
+       ElementPicard_13, ElementPicard_16, ElementPicard_19,
+       ElementPicard_25};
+
+// as ElementPicard(), but for the six nodes of a P2 element
+static void ElementPicardP2(const unfemCtx *user, const Quad2DTri *q,
+                            PetscInt k, const PetscInt *ae, const PetscInt *aem,
+                            const PetscInt *abf, const Node *aloc,
+                            const PetscReal *au, PetscReal Ke[6][6]) {
+    PetscInt   en[6], l, m, r;
+    PetscReal  unode[6], gradpsi[3][2], phi[6], gradphi[6][2],
+               xq[MAXPTS_TRI], yq[MAXPTS_TRI], absdetJ, uquad, wa;
+
+    ElementNodes(ae,aem,k,en);
+    ElementGeometry(user->mesh,q,k,en,aloc,&absdetJ,gradpsi,xq,yq);
+    for (l = 0; l < 6; l++) {
+        unode[l] = (abf[en[l]] == 2) ? user->gD[en[l]] : au[en[l]];
+        for (m = 0; m < 6; m++)
+            Ke[l][m] = 0.0;
+    }
+    for (r = 0; r < q->n; r++) {
+        P2Basis(q->xi[r],q->eta[r],gradpsi,phi,gradphi);
+        uquad = 0.0;
+        for (l = 0; l < 6; l++)
+            uquad += unode[l] * phi[l];
+        wa = absdetJ * q->w[r] * user->a_fcn(uquad,xq[r],yq[r]);
+        for (l = 0; l < 6; l++)
+            for (m = 0; m < 6; m++)
+                Ke[l][m] += wa * InnerProd(gradphi[l],gradphi[m]);
+    }
+}
+
+// add the non-Dirichlet entries of the element k Picard matrix directly
+//   into the value array of a MATSEQAIJ, using offsets from
+//   PreallocateAndSetNonzeros()
+static void ElementPicardCSR(const unfemCtx *user, const Quad2DTri *q,
+                             ElementPicardFcn elempic, PetscInt k,
+                             const PetscInt *ae,
+                             const PetscInt *aem, const PetscInt *abf,
+                             const Node *aloc, const PetscReal *au,
+                             PetscScalar *aP) {
+    const PetscInt  *off;
+    PetscReal       Ke[3][3], Ke2[6][6];
+    PetscInt        l, m;
+    if (aem) {
+        off = user->eoff + 36*k;
+        ElementPicardP2(user,q,k,ae,aem,abf,aloc,au,Ke2);
+        for (l = 0; l < 6; l++)
+            for (m = 0; m < 6; m++)
+                if (off[6*l+m] >= 0)
+                    aP[off[6*l+m]] += Ke2[l][m];
+        return;
+    }
+    off = user->eoff + 9*k;
+    elempic(user,q,k,ae,abf,aloc,au,Ke);
+    for (l = 0; l < 3; l++)
+        for (m = 0; m < 3; m++)
+            if (off[3*l+m] >= 0)
+                aP[off[3*l+m]] += Ke[l][m];
+}
+
+// only in debug builds: check that each non-Dirichlet entry of each element
+//   matrix has an offset in the row, and column, of P where it belongs; the
+//   direct writes in FormPicard() bypass MAT_NEW_NONZERO_LOCATION_ERR
+static PetscErrorCode CheckCSROffsets(Mat P, const unfemCtx *user,
+                                      const PetscInt *ae, const PetscInt *aem,
+                                      const PetscInt *abf) {
+    const PetscInt  *ia, *ja;
+    PetscInt        nrows, nen, en[6], k, l, m, o;
+    PetscBool       done;
+
+    PetscCall(MatGetRowIJ(P,0,PETSC_FALSE,PETSC_FALSE,&nrows,&ia,&ja,&done));
+    if (!done) {
+        SETERRQ(PETSC_COMM_SELF,1,"MatGetRowIJ() failed on Picard matrix\n");
+    }
+    for (k = 0; k < user->mesh->Kloc; k++) {
+        nen = ElementNodes(ae,aem,k,en);
+        for (l = 0; l < nen; l++) {
+            if (abf[en[l]] == 2)
+                continue;
+            for (m = 0; m < nen; m++) {
+                if (abf[en[m]] == 2)
+                    continue;
+                o = user->eoff[nen*nen*k+nen*l+m];
+                if ((o < ia[en[l]]) || (o >= ia[en[l]+1]) || (ja[o] != en[m])) {
+                    SETERRQ(PETSC_COMM_SELF,2,
+                            "offset %d of entry (%d,%d) of element %d not in CSR pattern\n",
+                            o,en[l],en[m],k);
                 }
-                aF[en[l]] += PetscAbsReal(detJ) * sum;
             }
         }
     }
+    PetscCall(MatRestoreRowIJ(P,0,PETSC_FALSE,PETSC_FALSE,&nrows,&ia,&ja,&done));
+    return 0;
+}
+
+//STARTPICARD
+PetscErrorCode FormPicard(SNES snes, Vec u, Mat A, Mat P, void *ctx) {
+    unfemCtx         *user = (unfemCtx*)ctx;
+    const Quad2DTri  q = symmgauss[user->quaddegree-1];
+    const ElementPicardFcn elempic = picardkernel[user->quaddegree-1];
+    const PetscInt   *ae, *abf, *aem = NULL;
+    const Node       *aloc;
+    const PetscReal  *au;
+    PetscScalar      *aP;
+    PetscReal        Ke[3][3], Ke2[6][6], v[36];
+    PetscInt         n, k, l, m, c, i, cr, cv, nen, en[6], row[6];
 
+    PetscLogStagePush(user->jacstage);  //STRIP
+    PetscCall(MatZeroEntries(P));
+    PetscCall(ISGetIndices(user->mesh->bf,&abf));
+    PetscCall(UMGlobalToLocal(user->mesh,u,user->uloc));
+    PetscCall(ISGetIndices(user->mesh->e,&ae));
+    if (user->p2) {
+        PetscCall(ISGetIndices(user->mesh->em,&aem));
+    }
+    PetscCall(VecGetArrayRead(user->uloc,&au));
+    PetscCall(UMGetNodeCoordArrayRead(user->mesh,&aloc));
+    if (user->eoff) {
+        // write directly into the CSR value array; no searches
+        if (PetscDefined(USE_DEBUG)) {
+            PetscCall(CheckCSROffsets(P,user,ae,aem,abf));
+        }
+        PetscCall(MatSeqAIJGetArray(P,&aP));
+        for (n = 0; n < user->mesh->Nown; n++)
+            if (abf[n] == 2)
+                aP[user->doff[n]] = 1.0;
+        if (user->mesh->colorptr) {
+            // elements of one color share no nodes, so no rows in common
+            for (c = 0; c < user->mesh->ncolors; c++) {
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static)
+#endif
+                for (i = user->mesh->colorptr[c]; i < user->mesh->colorptr[c+1]; i++)
+                    ElementPicardCSR(user,&q,elempic,user->mesh->colorelems[i],ae,aem,abf,aloc,au,aP);
+            }
+        } else {
+            for (k = 0; k < user->mesh->Kloc; k++)
+                ElementPicardCSR(user,&q,elempic,k,ae,aem,abf,aloc,au,aP);
+        }
+        PetscCall(MatSeqAIJRestoreArray(P,&aP));
+    } else {
+        for (n = 0; n < user->mesh->Nown; n++) {
+            if (abf[n] == 2) {
+                v[0] = 1.0;
+                PetscCall(MatSetValuesLocal(P,1,&n,1,&n,v,ADD_VALUES));
+            }
+        }
+        for (k = 0; k < user->mesh->Kloc; k++) {
+            nen = ElementNodes(ae,aem,k,en);
+            if (aem) {
+                ElementPicardP2(user,&q,k,ae,aem,abf,aloc,au,Ke2);
+            } else {
+                elempic(user,&q,k,ae,abf,aloc,au,Ke);
+            }
+            // 3x3 (or 6x6 for P2) element stiffness matrix (may be smaller)
+            cr = 0;  cv = 0;  // cr = count rows; cv = entry counter
+            for (l = 0; l < nen; l++) {
+                if (abf[en[l]] != 2) {
+                    row[cr++] = en[l];
+                    for (m = 0; m < nen; m++)
+                        if (abf[en[m]] != 2)
+                            v[cv++] = (aem) ? Ke2[l][m] : Ke[l][m];
+                }
+            }
+            PetscCall(MatSetValuesLocal(P,cr,row,cr,row,v,ADD_VALUES));
+        }
+    }
+    if (aem) {
+        PetscCall(ISRestoreIndices(user->mesh->em,&aem));
+    }
     PetscCall(ISRestoreIndices(user->mesh->e,&ae));
-    PetscCall(VecRestoreArrayRead(u,&au));
     PetscCall(ISRestoreIndices(user->mesh->bf,&abf));
+    PetscCall(VecRestoreArrayRead(user->uloc,&au));
     PetscCall(UMRestoreNodeCoordArrayRead(user->mesh,&aloc));
-    PetscCall(VecRestoreArray(F,&aF));
+
+    PetscCall(MatAssemblyBegin(P,MAT_FINAL_ASSEMBLY));
+    PetscCall(MatAssemblyEnd(P,MAT_FINAL_ASSEMBLY));
+    if (A != P) {
+        PetscCall(MatAssemblyBegin(A,MAT_FINAL_ASSEMBLY));
+        PetscCall(MatAssemblyEnd(A,MAT_FINAL_ASSEMBLY));
+    }
     PetscLogStagePop();  //STRIP
     return 0;
 }
-//ENDRESIDUAL
+//ENDPICARD
 
 
-//STARTPICARD
-PetscErrorCode FormPicard(SNES snes, Vec u, Mat A, Mat P, void *ctx) {
+/* The Newton Jacobian.  For non-Dirichlet nodes with hat functions psi_l
+and psi_m, where the residual is F_l = int a(u) grad u . grad psi_l
+- f(u) psi_l + (Neumann terms),
+
+  dF_l/du_m = int a(u) grad psi_m . grad psi_l
+                  + da/du(u) psi_m grad u . grad psi_l - df/du(u) psi_m psi_l
+
+The sparsity pattern is the same as for the Picard matrix, but the
+matrix is not symmetric. */
+PetscErrorCode FormNewton(SNES snes, Vec u, Mat A, Mat P, void *ctx) {
     unfemCtx         *user = (unfemCtx*)ctx;
     const Quad2DTri  q = symmgauss[user->quaddegree-1];
     const PetscInt   *ae, *abf, *en;
     const Node       *aloc;
     const PetscReal  *au;
-    PetscReal        unode[3], gradpsi[3][2], uquad[4], aquad[4], v[9],
-                     dx1, dx2, dy1, dy2, detJ, xx, yy, sum;
+    PetscReal        unode[3], gradu[2], gradpsi[3][2], uquad,
+                     aquad[MAXPTS_TRI], daquad[MAXPTS_TRI], dfquad[MAXPTS_TRI],
+                     psi[3][MAXPTS_TRI], v[9], xq[MAXPTS_TRI], yq[MAXPTS_TRI],
+                     absdetJ, sum;
     PetscInt         n, k, l, m, r, cr, cv, row[3];
 
     PetscLogStagePush(user->jacstage);  //STRIP
     PetscCall(MatZeroEntries(P));
     PetscCall(ISGetIndices(user->mesh->bf,&abf));
-    for (n = 0; n < user->mesh->N; n++) {
+    for (n = 0; n < user->mesh->Nown; n++) {
         if (abf[n] == 2) {
             v[0] = 1.0;
-            PetscCall(MatSetValues(P,1,&n,1,&n,v,ADD_VALUES));
+            PetscCall(MatSetValuesLocal(P,1,&n,1,&n,v,ADD_VALUES));
         }
     }
+    PetscCall(UMGlobalToLocal(user->mesh,u,user->uloc));
     PetscCall(ISGetIndices(user->mesh->e,&ae));
-    PetscCall(VecGetArrayRead(u,&au));
+    PetscCall(VecGetArrayRead(user->uloc,&au));
     PetscCall(UMGetNodeCoordArrayRead(user->mesh,&aloc));
-    for (k = 0; k < user->mesh->K; k++) {
+    for (l = 0; l < 3; l++)
+        for (r = 0; r < q.n; r++)
+            psi[l][r] = chi(l,q.xi[r],q.eta[r]);
+    for (k = 0; k < user->mesh->Kloc; k++) {
         en = ae + 3*k;  // en[0], en[1], en[2] are nodes of element k
-        // geometry of element
-        dx1 = aloc[en[1]].x - aloc[en[0]].x;
-        dx2 = aloc[en[2]].x - aloc[en[0]].x;
-        dy1 = aloc[en[1]].y - aloc[en[0]].y;
-        dy2 = aloc[en[2]].y - aloc[en[0]].y;
-        detJ = dx1 * dy2 - dx2 * dy1;
-        // gradients of hat functions and u on element
+        ElementGeometry(user->mesh,&q,k,en,aloc,&absdetJ,gradpsi,xq,yq);
+        // u and grad u on element
+        gradu[0] = 0.0;
+        gradu[1] = 0.0;
         for (l = 0; l < 3; l++) {
-            gradpsi[l][0] = ( dy2 * dchi[l][0] - dy1 * dchi[l][1]) / detJ;
-            gradpsi[l][1] = (-dx2 * dchi[l][0] + dx1 * dchi[l][1]) / detJ;
-            if (abf[en[l]] == 2)
-                unode[l] = user->gD_fcn(aloc[en[l]].x,aloc[en[l]].y);
-            else
-                unode[l] = au[en[l]];
+            unode[l] = (abf[en[l]] == 2) ? user->gD[en[l]] : au[en[l]];
+            gradu[0] += unode[l] * gradpsi[l][0];
+            gradu[1] += unode[l] * gradpsi[l][1];
         }
-        // function values at quadrature points on element
+        // coefficient values at quadrature points on element
         for (r = 0; r < q.n; r++) {
-            uquad[r] = eval(unode,q.xi[r],q.eta[r]);
-            xx = aloc[en[0]].x + dx1 * q.xi[r] + dx2 * q.eta[r];
-            yy = aloc[en[0]].y + dy1 * q.xi[r] + dy2 * q.eta[r];
-            aquad[r] = user->a_fcn(uquad[r],xx,yy);
+            uquad = eval(unode,q.xi[r],q.eta[r]);
+            aquad[r] = user->a_fcn(uquad,xq[r],yq[r]);
+            daquad[r] = user->dadu_fcn(uquad,xq[r],yq[r]);
+            dfquad[r] = user->dfdu_fcn(uquad,xq[r],yq[r]);
         }
-        // generate 3x3 element stiffness matrix (may be smaller)
+        // generate 3x3 element Jacobian (may be smaller); row l, column m
         cr = 0;  cv = 0;  // cr = count rows; cv = entry counter
         for (l = 0; l < 3; l++) {
             if (abf[en[l]] != 2) {
@@ -466,19 +1490,20 @@ PetscErrorCode FormPicard(SNES snes, Vec u, Mat A, Mat P, void *ctx) {
                     if (abf[en[m]] != 2) {
                         sum = 0.0;
                         for (r = 0; r < q.n; r++) {
-                            sum += q.w[r] * aquad[r]
-                                   * InnerProd(gradpsi[l],gradpsi[m]);
+                            sum += q.w[r] * ( aquad[r] * InnerProd(gradpsi[l],gradpsi[m])
+                                   + daquad[r] * psi[m][r] * InnerProd(gradu,gradpsi[l])
+                                   - dfquad[r] * psi[m][r] * psi[l][r] );
                         }
-                        v[cv++] = PetscAbsReal(detJ) * sum;
+                        v[cv++] = absdetJ * sum;
                     }
                 }
             }
         }
-        PetscCall(MatSetValues(P,cr,row,cr,row,v,ADD_VALUES));
+        PetscCall(MatSetValuesLocal(P,cr,row,cr,row,v,ADD_VALUES));
     }
     PetscCall(ISRestoreIndices(user->mesh->e,&ae));
     PetscCall(ISRestoreIndices(user->mesh->bf,&abf));
-    PetscCall(VecRestoreArrayRead(u,&au));
+    PetscCall(VecRestoreArrayRead(user->uloc,&au));
     PetscCall(UMRestoreNodeCoordArrayRead(user->mesh,&aloc));
 
     PetscCall(MatAssemblyBegin(P,MAT_FINAL_ASSEMBLY));
@@ -490,9 +1515,102 @@ PetscErrorCode FormPicard(SNES snes, Vec u, Mat A, Mat P, void *ctx) {
     PetscLogStagePop();  //STRIP
     return 0;
 }
-//ENDPICARD
 
 
+/* For a MATSEQAIJ matrix, build the exact CSR sparsity pattern from node
+adjacency, and record where the entries of each element matrix live in
+the value array, so that FormPicard() can add into that array directly. */
+static PetscErrorCode PreallocateExactCSR(Mat J, unfemCtx *user) {
+    UM              *mesh = user->mesh;
+    const PetscInt  *ae, *abf, *aem = NULL;
+    PetscInt        *start, *cnt, *cols, *ia, *ja, N = mesh->Nloc,
+                    nen = (user->p2) ? 6 : 3, en[6], n, k, l, m, nz, loc;
+
+    PetscCall(ISGetIndices(mesh->bf,&abf));
+    PetscCall(ISGetIndices(mesh->e,&ae));
+    if (user->p2) {
+        PetscCall(ISGetIndices(mesh->em,&aem));
+    }
+    // row length bounds: diagonal plus nen-1 per incident element
+    PetscCall(PetscMalloc2(N+1,&start,N,&cnt));
+    start[0] = 0;
+    for (n = 0; n < N; n++) {
+        start[n+1] = 1;
+        cnt[n] = 1;
+    }
+    for (k = 0; k < mesh->Kloc; k++) {
+        ElementNodes(ae,aem,k,en);
+        for (l = 0; l < nen; l++)
+            if (abf[en[l]] != 2)
+                start[en[l]+1] += nen - 1;
+    }
+    for (n = 0; n < N; n++)
+        start[n+1] += start[n];
+    // column lists, possibly with duplicates; Dirichlet rows are diagonal
+    PetscCall(PetscMalloc1(start[N],&cols));
+    for (n = 0; n < N; n++)
+        cols[start[n]] = n;
+    for (k = 0; k < mesh->Kloc; k++) {
+        ElementNodes(ae,aem,k,en);
+        for (l = 0; l < nen; l++) {
+            if (abf[en[l]] == 2)
+                continue;
+            for (m = 0; m < nen; m++)
+                if ((m != l) && (abf[en[m]] != 2))
+                    cols[start[en[l]] + cnt[en[l]]++] = en[m];
+        }
+    }
+    // sort and remove duplicates to get exact CSR
+    PetscCall(PetscMalloc1(N+1,&ia));
+    ia[0] = 0;
+    for (n = 0; n < N; n++) {
+        nz = cnt[n];
+        PetscCall(PetscSortRemoveDupsInt(&nz,cols+start[n]));
+        cnt[n] = nz;
+        ia[n+1] = ia[n] + nz;
+    }
+    PetscCall(PetscMalloc1(ia[N],&ja));
+    for (n = 0; n < N; n++)
+        PetscCall(PetscArraycpy(ja+ia[n],cols+start[n],cnt[n]));
+    PetscCall(PetscFree(cols));
+    PetscCall(PetscFree2(start,cnt));
+    // allocates exactly, inserts zeros, and assembles
+    PetscCall(MatSeqAIJSetPreallocationCSR(J,ia,ja,NULL));
+
+    // offsets of element entries, found by binary search within rows
+    PetscCall(PetscMalloc2(nen*nen*mesh->Kloc,&(user->eoff),mesh->Nown,&(user->doff)));
+    for (k = 0; k < mesh->Kloc; k++) {
+        ElementNodes(ae,aem,k,en);
+        for (l = 0; l < nen; l++) {
+            for (m = 0; m < nen; m++) {
+                user->eoff[nen*nen*k+nen*l+m] = -1;
+                if ((abf[en[l]] == 2) || (abf[en[m]] == 2))
+                    continue;
+                PetscCall(PetscFindInt(en[m],ia[en[l]+1]-ia[en[l]],ja+ia[en[l]],&loc));
+                if (loc < 0) {
+                    SETERRQ(PETSC_COMM_SELF,1,"entry (%d,%d) missing from CSR pattern\n",
+                            en[l],en[m]);
+                }
+                user->eoff[nen*nen*k+nen*l+m] = ia[en[l]] + loc;
+            }
+        }
+    }
+    for (n = 0; n < mesh->Nown; n++)
+        user->doff[n] = (abf[n] == 2) ? ia[n] : -1;
+    PetscCall(PetscFree(ia));
+    PetscCall(PetscFree(ja));
+    if (aem) {
+        PetscCall(ISRestoreIndices(mesh->em,&aem));
+    }
+    PetscCall(ISRestoreIndices(mesh->e,&ae));
+    PetscCall(ISRestoreIndices(mesh->bf,&abf));
+    // FormPicard() writes the value array directly, so this option does not
+    //   guard it (see CheckCSROffsets()), but it does catch FormNewton() and
+    //   -snes_fd_color inserting outside the pattern
+    PetscCall(MatSetOption(J,MAT_NEW_NONZERO_LOCATION_ERR,PETSC_TRUE));
+    return 0;
+}
+
 /* The following procedure is accomplishes essentially the same actions
 as DMCreateMatrix() when a DM is present.  It first preallocates storage
 for the sparse matrix by providing a count of the entries.  Then it
@@ -502,53 +1620,323 @@ there will be nonzero entries.  This means that -snes_fd_color can be used.
 Note that nnz[n] is the number of nonzeros in row n.  In our case it
 equals one for Dirichlet rows, it is one more than the number of incident
 triangles for an interior point, and it is two more than the number of
-incident triangles for Neumann boundary nodes. */
+incident triangles for Neumann boundary nodes.  For P2 the counts are
+upper bounds: each incident element adds at most three neighbors of a
+vertex and five of an edge node.  In parallel the counts of
+incident triangles are summed over processes using the ghost scatter, and
+the split of each count into diagonal-block and off-diagonal-block parts
+is a safe over-estimate.  For a MATSEQAIJ matrix, the exact pattern is
+computed instead by PreallocateExactCSR(). */
 //STARTPREALLOC
 PetscErrorCode PreallocateAndSetNonzeros(Mat J, unfemCtx *user) {
-    const PetscInt  *ae, *abf, *en;
-    PetscInt        *nnz, n, k, l, cr, row[3];
-    PetscReal       zero = 0.0,
-                    v[9] = {0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0};
+    UM              *mesh = user->mesh;
+    const PetscInt  *ae, *abf, *aem = NULL;
+    PetscInt        *dnnz, *onnz, n, k, l, cr, nen, en[6], row[6];
+    PetscReal       *acount, zero = 0.0, v[36];
+    Vec             count;
+    PetscBool       isseqaij;
+
+    PetscCall(PetscObjectTypeCompare((PetscObject)J,MATSEQAIJ,&isseqaij));
+    if (isseqaij) {
+        PetscCall(PreallocateExactCSR(J,user));
+        return 0;
+    }
 
     // preallocate: set number of nonzeros per row
-    PetscCall(ISGetIndices(user->mesh->bf,&abf));
-    PetscCall(ISGetIndices(user->mesh->e,&ae));
-    PetscCall(PetscMalloc1(user->mesh->N,&nnz));
-    for (n = 0; n < user->mesh->N; n++)
-        nnz[n] = (abf[n] == 1) ? 2 : 1;
-    for (k = 0; k < user->mesh->K; k++) {
-        en = ae + 3*k;  // en[0], en[1], en[2] are nodes of element k
-        for (l = 0; l < 3; l++)
+    PetscCall(ISGetIndices(mesh->bf,&abf));
+    PetscCall(ISGetIndices(mesh->e,&ae));
+    if (user->p2) {
+        PetscCall(ISGetIndices(mesh->em,&aem));
+    }
+    PetscCall(VecSet(user->Floc,0.0));
+    PetscCall(VecGetArray(user->Floc,&acount));
+    for (k = 0; k < mesh->Kloc; k++) {
+        nen = ElementNodes(ae,aem,k,en);
+        for (l = 0; l < nen; l++)
             if (abf[en[l]] != 2)
-                nnz[en[l]] += 1;
+                acount[en[l]] += (nen == 3) ? 1.0 : ((l < 3) ? 3.0 : 5.0);
+    }
+    PetscCall(VecRestoreArray(user->Floc,&acount));
+    PetscCall(MatCreateVecs(J,&count,NULL));
+    PetscCall(VecSet(count,0.0));
+    PetscCall(UMLocalToGlobal(mesh,user->Floc,ADD_VALUES,count));
+    PetscCall(PetscMalloc2(mesh->Nown,&dnnz,mesh->Nown,&onnz));
+    PetscCall(VecGetArray(count,&acount));
+    for (n = 0; n < mesh->Nown; n++) {
+        dnnz[n] = ((abf[n] == 1) ? ((user->p2) ? 3 : 2) : 1) + (PetscInt)acount[n];
+        onnz[n] = PetscMin(dnnz[n],mesh->N - mesh->Nown);
+        dnnz[n] = PetscMin(dnnz[n],mesh->Nown);
     }
-    PetscCall(MatSeqAIJSetPreallocation(J,-1,nnz));
-    PetscCall(PetscFree(nnz));
+    PetscCall(VecRestoreArray(count,&acount));
+    PetscCall(VecDestroy(&count));
+    PetscCall(MatXAIJSetPreallocation(J,1,dnnz,onnz,NULL,NULL));
+    PetscCall(PetscFree2(dnnz,onnz));
 
     // set nonzeros: put values (=zeros) in allocated locations
-    for (n = 0; n < user->mesh->N; n++) {
+    for (n = 0; n < mesh->Nown; n++) {
         if (abf[n] == 2) {
-            PetscCall(MatSetValues(J,1,&n,1,&n,&zero,INSERT_VALUES));
+            PetscCall(MatSetValuesLocal(J,1,&n,1,&n,&zero,INSERT_VALUES));
         }
     }
-    for (k = 0; k < user->mesh->K; k++) {
-        en = ae + 3*k;  // en[0], en[1], en[2] are nodes of element k
-        // a 3x3 element stiffness matrix (at most) for each element
+    PetscCall(PetscArrayzero(v,36));
+    for (k = 0; k < mesh->Kloc; k++) {
+        nen = ElementNodes(ae,aem,k,en);
+        // a 3x3 (6x6 for P2) element stiffness matrix (at most) per element
         cr = 0;  // cr = count rows
-        for (l = 0; l < 3; l++) {
+        for (l = 0; l < nen; l++) {
             if (abf[en[l]] != 2) {
                 row[cr++] = en[l];
             }
         }
-        PetscCall(MatSetValues(J,cr,row,cr,row,v,INSERT_VALUES));
+        PetscCall(MatSetValuesLocal(J,cr,row,cr,row,v,INSERT_VALUES));
     }
     PetscCall(MatAssemblyBegin(J,MAT_FINAL_ASSEMBLY));
     PetscCall(MatAssemblyEnd(J,MAT_FINAL_ASSEMBLY));
     // the assembly routine FormPicard() will generate an error if
     //   it tries to put a matrix entry in the wrong place
     PetscCall(MatSetOption(J,MAT_NEW_NONZERO_LOCATION_ERR,PETSC_TRUE));
+    if (aem) {
+        PetscCall(ISRestoreIndices(mesh->em,&aem));
+    }
+    PetscCall(ISRestoreIndices(mesh->e,&ae));
+    PetscCall(ISRestoreIndices(mesh->bf,&abf));
+    return 0;
+}
+//ENDPREALLOC
+
+
+/* For -un_matfree.  Saves the u-dependent coefficients needed by
+ShellMult(), and assembles the Picard matrix as the preconditioning
+matrix P, but only every picardlag calls. */
+PetscErrorCode FormShellJacobian(SNES snes, Vec u, Mat A, Mat P, void *ctx) {
+    unfemCtx         *user = (unfemCtx*)ctx;
+    const Quad2DTri  q = symmgauss[user->quaddegree-1];
+    const PetscInt   *ae, *abf, *en, K = user->mesh->Kloc;
+    const Node       *aloc;
+    const PetscReal  *au;
+    PetscInt         k, l, r;
+    PetscReal        unode[3], gradpsi[3][2], xq[MAXPTS_TRI], yq[MAXPTS_TRI],
+                     absdetJ, uquad;
+
+    PetscLogStagePush(user->jacstage);  //STRIP
+    PetscCall(UMGlobalToLocal(user->mesh,u,user->ujac));
+    PetscCall(ISGetIndices(user->mesh->e,&ae));
+    PetscCall(ISGetIndices(user->mesh->bf,&abf));
+    PetscCall(VecGetArrayRead(user->ujac,&au));
+    PetscCall(UMGetNodeCoordArrayRead(user->mesh,&aloc));
+    for (k = 0; k < K; k++) {
+        en = ae + 3*k;  // en[0], en[1], en[2] are nodes of element k
+        ElementGeometry(user->mesh,&q,k,en,aloc,&absdetJ,gradpsi,xq,yq);
+        user->gradu[2*k+0] = 0.0;
+        user->gradu[2*k+1] = 0.0;
+        for (l = 0; l < 3; l++) {
+            unode[l] = (abf[en[l]] == 2) ? user->gD[en[l]] : au[en[l]];
+            user->gradu[2*k+0] += unode[l] * gradpsi[l][0];
+            user->gradu[2*k+1] += unode[l] * gradpsi[l][1];
+        }
+        for (r = 0; r < q.n; r++) {
+            uquad = eval(unode,q.xi[r],q.eta[r]);
+            user->aq[r*K+k] = user->a_fcn(uquad,xq[r],yq[r]);
+            user->daq[r*K+k] = (user->newton) ? user->dadu_fcn(uquad,xq[r],yq[r]) : 0.0;
+            user->dfq[r*K+k] = (user->newton) ? user->dfdu_fcn(uquad,xq[r],yq[r]) : 0.0;
+        }
+    }
+    PetscCall(UMRestoreNodeCoordArrayRead(user->mesh,&aloc));
+    PetscCall(VecRestoreArrayRead(user->ujac,&au));
+    PetscCall(ISRestoreIndices(user->mesh->bf,&abf));
     PetscCall(ISRestoreIndices(user->mesh->e,&ae));
+    PetscCall(MatAssemblyBegin(A,MAT_FINAL_ASSEMBLY));
+    PetscCall(MatAssemblyEnd(A,MAT_FINAL_ASSEMBLY));
+    PetscLogStagePop();  //STRIP
+    if (user->jaccount % user->picardlag == 0) {
+        PetscCall(FormPicard(snes,u,P,P,ctx));
+    }
+    user->jaccount++;
+    return 0;
+}
+
+/* Jacobian action y = J v, computed element-by-element.  For a
+non-Dirichlet node, which has hat function psi, this is
+
+  (J v)_psi = int a(u) grad v . grad psi + da/du(u) v grad u . grad psi
+                 - df/du(u) v psi
+
+where the last two terms are only included for Newton.  As in FormFunction(),
+the Dirichlet values of v do not enter element integrals, and the Dirichlet
+rows are the identity. */
+PetscErrorCode ShellMult(Mat J, Vec v, Vec y) {
+    unfemCtx         *user;
+    const Quad2DTri  *q;
+    const PetscInt   *ae, *abf, *en;
+    const Node       *aloc;
+    const PetscReal  *av;
+    PetscInt         K, n, k, l, r;
+    PetscReal        *ay, vnode[3], gradv[2], gradpsi[3][2], xq[MAXPTS_TRI],
+                     yq[MAXPTS_TRI], absdetJ, sum, term;
+
+    PetscCall(MatShellGetContext(J,&user));
+    q = &(symmgauss[user->quaddegree-1]);
+    K = user->mesh->Kloc;
+    PetscCall(UMGlobalToLocal(user->mesh,v,user->vloc));
+    PetscCall(VecSet(user->Floc,0.0));
+    PetscCall(VecGetArray(user->Floc,&ay));
+    PetscCall(VecGetArrayRead(user->vloc,&av));
+    PetscCall(ISGetIndices(user->mesh->e,&ae));
+    PetscCall(ISGetIndices(user->mesh->bf,&abf));
+    PetscCall(UMGetNodeCoordArrayRead(user->mesh,&aloc));
+    for (k = 0; k < K; k++) {
+        en = ae + 3*k;  // en[0], en[1], en[2] are nodes of element k
+        ElementGeometry(user->mesh,q,k,en,aloc,&absdetJ,gradpsi,xq,yq);
+        gradv[0] = 0.0;
+        gradv[1] = 0.0;
+        for (l = 0; l < 3; l++) {
+            vnode[l] = (abf[en[l]] == 2) ? 0.0 : av[en[l]];
+            gradv[0] += vnode[l] * gradpsi[l][0];
+            gradv[1] += vnode[l] * gradpsi[l][1];
+        }
+        for (l = 0; l < 3; l++) {
+            if (abf[en[l]] != 2) {
+                sum = 0.0;
+                for (r = 0; r < q->n; r++) {
+                    term = user->aq[r*K+k] * InnerProd(gradv,gradpsi[l]);
+                    if (user->newton)
+                        term += eval(vnode,q->xi[r],q->eta[r])
+                                * (user->daq[r*K+k] * InnerProd(user->gradu+2*k,gradpsi[l])
+                                   - user->dfq[r*K+k] * chi(l,q->xi[r],q->eta[r]));
+                    sum += q->w[r] * term;
+                }
+                ay[en[l]] += absdetJ * sum;
+            }
+        }
+    }
+    for (n = 0; n < user->mesh->Nown; n++)
+        if (abf[n] == 2)
+            ay[n] = av[n];
+    PetscCall(UMRestoreNodeCoordArrayRead(user->mesh,&aloc));
     PetscCall(ISRestoreIndices(user->mesh->bf,&abf));
+    PetscCall(ISRestoreIndices(user->mesh->e,&ae));
+    PetscCall(VecRestoreArrayRead(user->vloc,&av));
+    PetscCall(VecRestoreArray(user->Floc,&ay));
+    PetscCall(VecSet(y,0.0));
+    PetscCall(UMLocalToGlobal(user->mesh,user->Floc,ADD_VALUES,y));
+    return 0;
+}
+
+// Dorfler (bulk) marking: mark a smallest set of elements whose eta2 sum
+//   to at least theta times the total
+static PetscErrorCode MarkBulk(PetscInt K, const PetscReal *eta2,
+                               PetscReal theta, PetscBool *marked) {
+    PetscInt   *perm, k;
+    PetscReal  total = 0.0, sum = 0.0;
+    PetscCall(PetscMalloc1(K,&perm));
+    for (k = 0; k < K; k++) {
+        perm[k] = k;
+        marked[k] = PETSC_FALSE;
+        total += eta2[k];
+    }
+    PetscCall(PetscSortRealWithPermutation(K,eta2,perm));  // increasing
+    for (k = K-1; (k >= 0) && (sum < theta * total); k--) {
+        marked[perm[k]] = PETSC_TRUE;
+        sum += eta2[perm[k]];
+    }
+    PetscCall(PetscFree(perm));
+    return 0;
+}
+
+/* For -un_amr_steps.  Adapt the whole mesh, on one process, before the
+final solve in main():  each step solves on the current mesh, computes
+ErrorIndicators(), marks by MarkBulk(), and refines by UMRefineMarked().
+The solution is interpolated to the refined mesh to start the next solve.
+Stops after steps refinements, or without refining when the estimated error
+(sqrt of the sum of eta2) is at most tol.  On return *uinit, on the final
+mesh, is the initial iterate for the final solve. */
+PetscErrorCode AdaptMesh(unfemCtx *user, PetscInt steps, PetscReal theta,
+                         PetscReal tol, Vec *uinit) {
+    UM         *mesh = user->mesh;
+    PetscInt   s, k, Nc;
+    PetscReal  *eta2, est;
+    PetscBool  *marked;
+    SNES       snes;
+    KSP        ksp;
+    PC         pc;
+    Mat        A, P = NULL;
+    Vec        r, u, uold = NULL;
+    IS         midparents;
+
+    for (s = 0; s < steps; s++) {
+        // set up and solve as in main(), with an assembled Jacobian
+        PetscCall(UMDistribute(mesh));
+        PetscCall(VecCreate(PETSC_COMM_WORLD,&r));
+        PetscCall(VecSetSizes(r,mesh->Nown,mesh->N));
+        PetscCall(VecSetFromOptions(r));
+        PetscCall(VecDuplicate(r,&u));
+        if (P) {
+            PetscCall(MatMult(P,uold,u));
+            PetscCall(MatDestroy(&P));
+            PetscCall(VecDestroy(&uold));
+        } else {
+            PetscCall(VecSet(u,0.0));
+        }
+        PetscCall(UMCreateLocalVec(mesh,&(user->uloc)));
+        PetscCall(VecDuplicate(user->uloc,&(user->Floc)));
+        PetscCall(FillDataCaches(user));
+        PetscCall(SNESCreate(PETSC_COMM_WORLD,&snes));
+        PetscCall(SNESSetFunction(snes,r,FormFunction,user));
+        PetscCall(SNESGetKSP(snes,&ksp));
+        PetscCall(KSPSetType(ksp,(user->newton) ? KSPGMRES : KSPCG));
+        PetscCall(KSPGetPC(ksp,&pc));
+        PetscCall(PCSetType(pc,(user->newton) ? PCILU : PCICC));
+        PetscCall(MatCreate(PETSC_COMM_WORLD,&A));
+        PetscCall(MatSetSizes(A,mesh->Nown,mesh->Nown,mesh->N,mesh->N));
+        PetscCall(MatSetFromOptions(A));
+        if (!user->newton) {
+            PetscCall(MatSetOption(A,MAT_SYMMETRIC,PETSC_TRUE));
+        }
+        PetscCall(MatSetLocalToGlobalMapping(A,mesh->l2g,mesh->l2g));
+        PetscCall(PreallocateAndSetNonzeros(A,user));
+        PetscCall(SNESSetJacobian(snes,A,A,(user->newton) ? FormNewton : FormPicard,user));
+        PetscCall(SNESSetFromOptions(snes));
+        PetscCall(SNESSolve(snes,NULL,u));
+
+        // estimate, mark, and refine
+        PetscCall(PetscMalloc2(mesh->Kloc,&eta2,mesh->Kloc,&marked));
+        PetscCall(ErrorIndicators(user,u,eta2));
+        est = 0.0;
+        for (k = 0; k < mesh->Kloc; k++)
+            est += eta2[k];
+        est = PetscSqrtReal(est);
+        PetscCall(PetscPrintf(PETSC_COMM_WORLD,
+                   "  adaptive step %d: N=%d nodes, K=%d elements, estimated error %.3e\n",
+                   s,mesh->N,mesh->K,est));
+        if (est > tol) {
+            PetscCall(MarkBulk(mesh->Kloc,eta2,theta,marked));
+            Nc = mesh->N;
+            PetscCall(UMRefineMarked(mesh,marked,&midparents));
+            PetscCall(UMCreateRefinementInterpolation(Nc,midparents,NULL,PETSC_DECIDE,&P));
+            PetscCall(ISDestroy(&midparents));
+        }
+        PetscCall(PetscFree2(eta2,marked));
+
+        // clean-up objects which belong to the old mesh
+        PetscCall(VecDestroy(&(user->uloc)));
+        PetscCall(VecDestroy(&(user->Floc)));
+        PetscCall(PetscFree2(user->gD,user->fq));
+        PetscCall(VecDestroy(&(user->gN)));
+        PetscCall(PetscFree2(user->eoff,user->doff));
+        PetscCall(MatDestroy(&A));
+        PetscCall(SNESDestroy(&snes));
+        PetscCall(VecDestroy(&r));
+        uold = u;
+        if (!P)
+            break;
+    }
+    if (P) {
+        PetscCall(MatCreateVecs(P,NULL,uinit));
+        PetscCall(MatMult(P,uold,*uinit));
+        PetscCall(MatDestroy(&P));
+        PetscCall(VecDestroy(&uold));
+    } else {
+        *uinit = uold;
+    }
     return 0;
 }
-//ENDPREALLOC
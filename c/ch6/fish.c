@@ -141,6 +141,7 @@ int main(int argc,char **argv) {
     ProblemType    problem = MANUEXP;        // manufactured problem using exp()
     InitialType    initial = ZEROS;          // set u=0 for initial iterate
     PetscBool      gonboundary = PETSC_TRUE; // initial iterate has u=g on boundary
+    PetscBool      fusedjacobi = PETSC_FALSE; // PCMG levels use default smoother
 
     PetscCall(PetscInitialize(&argc,&argv,NULL,help));
 
@@ -164,6 +165,9 @@ int main(int argc,char **argv) {
     PetscCall(PetscOptionsInt("-dim",
          "dimension of problem (=1,2,3 only)",
          "fish.c",dim,&dim,NULL));
+    PetscCall(PetscOptionsBool("-fusedjacobi",
+         "use fused-sweep Jacobi smoother on non-coarse levels of -pc_type mg (2D only)",
+         "fish.c",fusedjacobi,&fusedjacobi,NULL));
     PetscCall(PetscOptionsBool("-initial_gonboundary",
          "set initial iterate to have correct boundary values",
          "fish.c",gonboundary,&gonboundary,NULL));
@@ -233,6 +237,26 @@ int main(int argc,char **argv) {
     PetscCall(KSPSetType(ksp,KSPCG));
     PetscCall(SNESSetFromOptions(snes));
 
+    // replace the smoother PC on each non-coarse multigrid level
+    if (fusedjacobi) {
+        PC        pc, pclev;
+        KSP       ksplev;
+        PetscInt  nlev, l;
+        PetscBool ismg;
+        PetscCall(KSPGetPC(ksp,&pc));
+        PetscCall(PetscObjectTypeCompare((PetscObject)pc,PCMG,&ismg));
+        if (!ismg) {
+            SETERRQ(PETSC_COMM_SELF,5,"-fsh_fusedjacobi requires -pc_type mg\n");
+        }
+        PetscCall(PCMGGetLevels(pc,&nlev));
+        for (l = 1; l < nlev; l++) {
+            PetscCall(PCMGGetSmoother(pc,l,&ksplev));
+            PetscCall(KSPGetPC(ksplev,&pclev));
+            PetscCall(PCSetType(pclev,PCSHELL));
+            PetscCall(PoissonFusedJacobiSetUp(pclev));
+        }
+    }
+
     // set initial iterate and then solve
     PetscCall(DMGetGlobalVector(da,&u_initial));
     PetscCall(InitialState(da, initial, gonboundary, u_initial, &user));
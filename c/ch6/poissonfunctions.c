@@ -25,51 +25,197 @@ PetscErrorCode Poisson1DFunctionLocal(DMDALocalInfo *info, PetscReal *au,
     return 0;
 }
 
+/* Data which does not depend on u is computed at the first residual
+evaluation on a DMDA and cached in two Vecs composed with it:  g at the
+boundary points of the local (owned plus ghost) part of the grid, zero
+elsewhere, and the right-hand side b = (cell measure) f at the owned
+interior points, zero on the boundary.  Each grid from -snes_grid_sequence
+or multigrid is a new DMDA, so it gets its own cache, but g_bdry() and
+f_rhs() must not change while a DMDA exists.  (The Vecs are not created by
+the DMDA, which would make a reference cycle.)  Dimensions 2 and 3 only. */
+static PetscErrorCode DataCache(DMDALocalInfo *info, PoissonCtx *user,
+                                Vec *gloc, Vec *b) {
+    PetscInt   i, j, k;
+    PetscReal  xyzmin[3], xyzmax[3], hx, hy, hz, x, y, z;
+    Vec        g, f;
+
+    PetscCall(PetscObjectQuery((PetscObject)(info->da),"poisson_gbdry",
+                               (PetscObject*)gloc));
+    PetscCall(PetscObjectQuery((PetscObject)(info->da),"poisson_rhs",
+                               (PetscObject*)b));
+    if (*gloc && *b) {
+        return 0;
+    }
+    PetscCall(VecCreateSeq(PETSC_COMM_SELF,info->gxm*info->gym*info->gzm,&g));
+    PetscCall(VecCreateSeq(PETSC_COMM_SELF,info->xm*info->ym*info->zm,&f));
+    PetscCall(VecSet(g,0.0));
+    PetscCall(VecSet(f,0.0));
+    PetscCall(DMGetBoundingBox(info->da,xyzmin,xyzmax));
+    hx = (xyzmax[0] - xyzmin[0]) / (info->mx - 1);
+    hy = (xyzmax[1] - xyzmin[1]) / (info->my - 1);
+    if (info->dim == 2) {
+        PetscReal **ag, **af;
+        PetscCall(DMDAVecGetArray(info->da,g,&ag));
+        PetscCall(DMDAVecGetArray(info->da,f,&af));
+        for (j = info->gys; j < info->gys + info->gym; j++) {
+            y = xyzmin[1] + j * hy;
+            for (i = info->gxs; i < info->gxs + info->gxm; i++) {
+                x = xyzmin[0] + i * hx;
+                if (i==0 || i==info->mx-1 || j==0 || j==info->my-1)
+                    ag[j][i] = user->g_bdry(x,y,0.0,user);
+                else if (   i >= info->xs && i < info->xs + info->xm
+                         && j >= info->ys && j < info->ys + info->ym)
+                    af[j][i] = hx * hy * user->f_rhs(x,y,0.0,user);
+            }
+        }
+        PetscCall(DMDAVecRestoreArray(info->da,f,&af));
+        PetscCall(DMDAVecRestoreArray(info->da,g,&ag));
+    } else if (info->dim == 3) {
+        PetscReal ***ag, ***af;
+        hz = (xyzmax[2] - xyzmin[2]) / (info->mz - 1);
+        PetscCall(DMDAVecGetArray(info->da,g,&ag));
+        PetscCall(DMDAVecGetArray(info->da,f,&af));
+        for (k = info->gzs; k < info->gzs + info->gzm; k++) {
+            z = xyzmin[2] + k * hz;
+            for (j = info->gys; j < info->gys + info->gym; j++) {
+                y = xyzmin[1] + j * hy;
+                for (i = info->gxs; i < info->gxs + info->gxm; i++) {
+                    x = xyzmin[0] + i * hx;
+                    if (   i==0 || i==info->mx-1
+                        || j==0 || j==info->my-1
+                        || k==0 || k==info->mz-1)
+                        ag[k][j][i] = user->g_bdry(x,y,z,user);
+                    else if (   i >= info->xs && i < info->xs + info->xm
+                             && j >= info->ys && j < info->ys + info->ym
+                             && k >= info->zs && k < info->zs + info->zm)
+                        af[k][j][i] = hx * hy * hz * user->f_rhs(x,y,z,user);
+                }
+            }
+        }
+        PetscCall(DMDAVecRestoreArray(info->da,f,&af));
+        PetscCall(DMDAVecRestoreArray(info->da,g,&ag));
+    } else {
+        SETERRQ(PETSC_COMM_SELF,7,"data cache is for dim 2 or 3\n");
+    }
+    PetscCall(PetscObjectCompose((PetscObject)(info->da),"poisson_gbdry",
+                                 (PetscObject)g));
+    PetscCall(PetscObjectCompose((PetscObject)(info->da),"poisson_rhs",
+                                 (PetscObject)f));
+    PetscCall(PetscObjectDereference((PetscObject)g));  // DMDA holds them
+    PetscCall(PetscObjectDereference((PetscObject)f));
+    *gloc = g;
+    *b = f;
+    return 0;
+}
+
+/* In 2D and 3D the residual is computed in two parts.  First, points whose
+neighbors are all interior (2 <= i <= mx-3, etc.) are swept without branches
+or boundary values, contiguously in i, so the compiler can vectorize.  Then
+the remaining owned points, namely boundary faces and the strips next to
+them, are visited.  Boundary values and the right-hand side come from
+DataCache(), so the interior sweep is a pure stencil application. */
 //STARTFORM2DFUNCTION
 PetscErrorCode Poisson2DFunctionLocal(DMDALocalInfo *info, PetscReal **au,
                                       PetscReal **aF, PoissonCtx *user) {
-    PetscInt   i, j;
-    PetscReal  xymin[2], xymax[2], hx, hy, darea, scx, scy, scdiag, x, y,
-               ue, uw, un, us;
+    PetscInt   i, j, il, ir;
+    PetscReal  xymin[2], xymax[2], hx, hy, scx, scy, scdiag, ue, uw, un, us;
+    const PetscReal **ag, **ab;
+    PetscBool  deep;
+    Vec        gloc, b;
     PetscCall(DMGetBoundingBox(info->da,xymin,xymax));
     hx = (xymax[0] - xymin[0]) / (info->mx - 1);
     hy = (xymax[1] - xymin[1]) / (info->my - 1);
-    darea = hx * hy;
     scx = user->cx * hy / hx;
     scy = user->cy * hx / hy;
     scdiag = 2.0 * (scx + scy);    // diagonal scaling
+    PetscCall(DataCache(info,user,&gloc,&b));
+    PetscCall(DMDAVecGetArrayRead(info->da,gloc,&ag));
+    PetscCall(DMDAVecGetArrayRead(info->da,b,&ab));
+    il = PetscMax(info->xs,2);
+    ir = PetscMin(info->xs + info->xm,info->mx-2);
+    for (j = PetscMax(info->ys,2); j < PetscMin(info->ys + info->ym,info->my-2); j++) {
+        for (i = il; i < ir; i++) {
+            aF[j][i] = scdiag * au[j][i]
+                       - scx * (au[j][i-1] + au[j][i+1])
+                       - scy * (au[j-1][i] + au[j+1][i])
+                       - ab[j][i];
+        }
+    }
     for (j = info->ys; j < info->ys + info->ym; j++) {
-        y = xymin[1] + j * hy;
+        deep = (j >= 2 && j < info->my-2);
         for (i = info->xs; i < info->xs + info->xm; i++) {
-            x = xymin[0] + i * hx;
+            if (deep && i >= 2 && i < info->mx-2) {
+                i = ir - 1;  // skip points done above
+                continue;
+            }
             if (i==0 || i==info->mx-1 || j==0 || j==info->my-1) {
-                aF[j][i] = au[j][i] - user->g_bdry(x,y,0.0,user);
-                aF[j][i] *= scdiag;
+                aF[j][i] = scdiag * (au[j][i] - ag[j][i]);
             } else {
-                ue = (i+1 == info->mx-1) ? user->g_bdry(x+hx,y,0.0,user)
-                                         : au[j][i+1];
-                uw = (i-1 == 0)          ? user->g_bdry(x-hx,y,0.0,user)
-                                         : au[j][i-1];
-                un = (j+1 == info->my-1) ? user->g_bdry(x,y+hy,0.0,user)
-                                         : au[j+1][i];
-                us = (j-1 == 0)          ? user->g_bdry(x,y-hy,0.0,user)
-                                         : au[j-1][i];
+                ue = (i+1 == info->mx-1) ? ag[j][i+1] : au[j][i+1];
+                uw = (i-1 == 0)          ? ag[j][i-1] : au[j][i-1];
+                un = (j+1 == info->my-1) ? ag[j+1][i] : au[j+1][i];
+                us = (j-1 == 0)          ? ag[j-1][i] : au[j-1][i];
                 aF[j][i] = scdiag * au[j][i]
-                           - scx * (uw + ue) - scy * (us + un)
-                           - darea * user->f_rhs(x,y,0.0,user);
+                           - scx * (uw + ue) - scy * (us + un) - ab[j][i];
             }
         }
     }
+    PetscCall(DMDAVecRestoreArrayRead(info->da,b,&ab));
+    PetscCall(DMDAVecRestoreArrayRead(info->da,gloc,&ag));
     PetscCall(PetscLogFlops(11.0*info->xm*info->ym));
     return 0;
 }
 //ENDFORM2DFUNCTION
 
+/* On large 3D grids the planes k-1 and k+1 are evicted from cache before
+they are reused when the sweep covers the whole local box.  The 3D sweeps
+below are therefore blocked ("2.5D"): the j range is cut into slabs of
+-poisson_tile_j rows, and the k range into blocks of -poisson_tile_k planes
+which are streamed through for each slab, so that three planes of a slab
+stay in cache.  The default 0 means no cutting.  The result does not depend
+on the tile sizes.  The options are read at the first sweep on a DMDA and
+cached on it as composed integer data. */
+static PetscInt tilejid = -1, tilekid = -1;
+
+static PetscErrorCode TileSizes(DM da, PetscInt *tj, PetscInt *tk) {
+    const char *prefix;
+    PetscBool  hasj = PETSC_FALSE, hask = PETSC_FALSE;
+    if (tilejid < 0) {
+        PetscCall(PetscObjectComposedDataRegister(&tilejid));
+        PetscCall(PetscObjectComposedDataRegister(&tilekid));
+    }
+    PetscCall(PetscObjectComposedDataGetInt((PetscObject)da,tilejid,*tj,hasj));
+    PetscCall(PetscObjectComposedDataGetInt((PetscObject)da,tilekid,*tk,hask));
+    if (hasj && hask)
+        return 0;
+    *tj = 0;
+    *tk = 0;
+    PetscCall(PetscObjectGetOptionsPrefix((PetscObject)da,&prefix));
+    PetscOptionsBegin(PetscObjectComm((PetscObject)da),prefix,
+                      "options for 3D Poisson sweeps","");
+    PetscCall(PetscOptionsInt("-poisson_tile_j",
+         "rows of j per slab in blocked 3D sweeps (0 = all)",
+         "poissonfunctions.c",*tj,tj,NULL));
+    PetscCall(PetscOptionsInt("-poisson_tile_k",
+         "planes of k per block in blocked 3D sweeps (0 = all)",
+         "poissonfunctions.c",*tk,tk,NULL));
+    PetscOptionsEnd();
+    if (*tj < 0 || *tk < 0) {
+        SETERRQ(PETSC_COMM_SELF,8,"tile sizes must be nonnegative\n");
+    }
+    PetscCall(PetscObjectComposedDataSetInt((PetscObject)da,tilejid,*tj));
+    PetscCall(PetscObjectComposedDataSetInt((PetscObject)da,tilekid,*tk));
+    return 0;
+}
+
 PetscErrorCode Poisson3DFunctionLocal(DMDALocalInfo *info, PetscReal ***au,
                                       PetscReal ***aF, PoissonCtx *user) {
-    PetscInt   i, j, k;
+    PetscInt   i, j, k, il, ir, jl, jr, kl, kr, tj, tk, jb, kb;
     PetscReal  xyzmin[3], xyzmax[3], hx, hy, hz, dvol, scx, scy, scz, scdiag,
-               x, y, z, ue, uw, un, us, uu, ud;
+               ue, uw, un, us, uu, ud;
+    const PetscReal ***ag, ***ab;
+    PetscBool  deep;
+    Vec        gloc, b;
     PetscCall(DMGetBoundingBox(info->da,xyzmin,xyzmax));
     hx = (xyzmax[0] - xyzmin[0]) / (info->mx - 1);
     hy = (xyzmax[1] - xyzmin[1]) / (info->my - 1);
@@ -79,47 +225,424 @@ PetscErrorCode Poisson3DFunctionLocal(DMDALocalInfo *info, PetscReal ***au,
     scy = user->cy * dvol / (hy*hy);
     scz = user->cz * dvol / (hz*hz);
     scdiag = 2.0 * (scx + scy + scz);
+    PetscCall(DataCache(info,user,&gloc,&b));
+    PetscCall(DMDAVecGetArrayRead(info->da,gloc,&ag));
+    PetscCall(DMDAVecGetArrayRead(info->da,b,&ab));
+    il = PetscMax(info->xs,2);
+    ir = PetscMin(info->xs + info->xm,info->mx-2);
+    jl = PetscMax(info->ys,2);
+    jr = PetscMin(info->ys + info->ym,info->my-2);
+    kl = PetscMax(info->zs,2);
+    kr = PetscMin(info->zs + info->zm,info->mz-2);
+    PetscCall(TileSizes(info->da,&tj,&tk));
+    if (tj == 0)  tj = PetscMax(jr - jl,1);
+    if (tk == 0)  tk = PetscMax(kr - kl,1);
+    for (kb = kl; kb < kr; kb += tk) {
+        for (jb = jl; jb < jr; jb += tj) {
+            for (k = kb; k < PetscMin(kb + tk,kr); k++) {
+                for (j = jb; j < PetscMin(jb + tj,jr); j++) {
+                    for (i = il; i < ir; i++) {
+                        aF[k][j][i] = scdiag * au[k][j][i]
+                            - scx * (au[k][j][i-1] + au[k][j][i+1])
+                            - scy * (au[k][j-1][i] + au[k][j+1][i])
+                            - scz * (au[k-1][j][i] + au[k+1][j][i])
+                            - ab[k][j][i];
+                    }
+                }
+            }
+        }
+    }
     for (k = info->zs; k < info->zs + info->zm; k++) {
-        z = xyzmin[2] + k * hz;
         for (j = info->ys; j < info->ys + info->ym; j++) {
-            y = xyzmin[1] + j * hy;
+            deep = (j >= 2 && j < info->my-2 && k >= 2 && k < info->mz-2);
             for (i = info->xs; i < info->xs + info->xm; i++) {
-                x = xyzmin[0] + i * hx;
+                if (deep && i >= 2 && i < info->mx-2) {
+                    i = ir - 1;  // skip points done above
+                    continue;
+                }
                 if (   i==0 || i==info->mx-1
                     || j==0 || j==info->my-1
                     || k==0 || k==info->mz-1) {
-                    aF[k][j][i] = au[k][j][i] - user->g_bdry(x,y,z,user);
-                    aF[k][j][i] *= scdiag;
+                    aF[k][j][i] = scdiag * (au[k][j][i] - ag[k][j][i]);
                 } else {
-                    ue = (i+1 == info->mx-1) ? user->g_bdry(x+hx,y,z,user)
-                                             : au[k][j][i+1];
-                    uw = (i-1 == 0)          ? user->g_bdry(x-hx,y,z,user)
-                                             : au[k][j][i-1];
-                    un = (j+1 == info->my-1) ? user->g_bdry(x,y+hy,z,user)
-                                             : au[k][j+1][i];
-                    us = (j-1 == 0)          ? user->g_bdry(x,y-hy,z,user)
-                                             : au[k][j-1][i];
-                    uu = (k+1 == info->mz-1) ? user->g_bdry(x,y,z+hz,user)
-                                             : au[k+1][j][i];
-                    ud = (k-1 == 0)          ? user->g_bdry(x,y,z-hz,user)
-                                             : au[k-1][j][i];
+                    ue = (i+1 == info->mx-1) ? ag[k][j][i+1] : au[k][j][i+1];
+                    uw = (i-1 == 0)          ? ag[k][j][i-1] : au[k][j][i-1];
+                    un = (j+1 == info->my-1) ? ag[k][j+1][i] : au[k][j+1][i];
+                    us = (j-1 == 0)          ? ag[k][j-1][i] : au[k][j-1][i];
+                    uu = (k+1 == info->mz-1) ? ag[k+1][j][i] : au[k+1][j][i];
+                    ud = (k-1 == 0)          ? ag[k-1][j][i] : au[k-1][j][i];
                     aF[k][j][i] = scdiag * au[k][j][i]
                         - scx * (uw + ue) - scy * (us + un) - scz * (uu + ud)
-                        - dvol * user->f_rhs(x,y,z,user);
+                        - ab[k][j][i];
                 }
             }
         }
     }
+    PetscCall(DMDAVecRestoreArrayRead(info->da,b,&ab));
+    PetscCall(DMDAVecRestoreArrayRead(info->da,gloc,&ag));
     PetscCall(PetscLogFlops(14.0*info->xm*info->ym*info->zm));
     return 0;
 }
 
+// stencil coefficients sc[d] = c_d (hx hy hz) / h_d^2, over the dimensions
+//   present, and the diagonal scdiag = 2 (sc[0] + ... ); as in the functions
+//   above, so that A / h^d approximates the Laplacian
+static PetscErrorCode StencilCoefficients(DMDALocalInfo *info, PoissonCtx *user,
+                                          PetscReal sc[3], PetscReal *scdiag) {
+    const PetscInt  m[3] = {info->mx, info->my, info->mz};
+    const PetscReal c[3] = {user->cx, user->cy, user->cz};
+    PetscReal       xyzmin[3], xyzmax[3], h[3], dvol = 1.0;
+    PetscInt        d;
+    PetscCall(DMGetBoundingBox(info->da,xyzmin,xyzmax));
+    for (d = 0; d < info->dim; d++) {
+        h[d] = (xyzmax[d] - xyzmin[d]) / (m[d] - 1);
+        dvol *= h[d];
+    }
+    *scdiag = 0.0;
+    for (d = 0; d < 3; d++) {
+        sc[d] = (d < info->dim) ? c[d] * dvol / (h[d]*h[d]) : 0.0;
+        *scdiag += 2.0 * sc[d];
+    }
+    return 0;
+}
+
+PetscErrorCode PoissonShellMult(Mat A, Vec x, Vec y) {
+    PoissonCtx     *user;
+    DM             da;
+    DMDALocalInfo  info;
+    Vec            xloc;
+    PetscReal      sc[3], scdiag;
+    PetscInt       i, j, k, tj, tk, jb, kb;
+
+    PetscCall(MatShellGetContext(A,&user));
+    PetscCall(MatGetDM(A,&da));
+    PetscCall(DMDAGetLocalInfo(da,&info));
+    PetscCall(StencilCoefficients(&info,user,sc,&scdiag));
+    PetscCall(DMGetLocalVector(da,&xloc));
+    PetscCall(DMGlobalToLocal(da,x,INSERT_VALUES,xloc));
+    // neighbors on the boundary are omitted, exactly as in the Jacobians
+    switch (info.dim) {
+        case 1:
+        {
+            const PetscReal *ax;
+            PetscReal       *ay;
+            PetscCall(DMDAVecGetArrayRead(da,xloc,&ax));
+            PetscCall(DMDAVecGetArray(da,y,&ay));
+            for (i = info.xs; i < info.xs+info.xm; i++) {
+                ay[i] = scdiag * ax[i];
+                if (i==0 || i==info.mx-1)
+                    continue;
+                if (i-1 > 0)          ay[i] -= sc[0] * ax[i-1];
+                if (i+1 < info.mx-1)  ay[i] -= sc[0] * ax[i+1];
+            }
+            PetscCall(DMDAVecRestoreArray(da,y,&ay));
+            PetscCall(DMDAVecRestoreArrayRead(da,xloc,&ax));
+            break;
+        }
+        case 2:
+        {
+            const PetscReal **ax;
+            PetscReal       **ay;
+            PetscCall(DMDAVecGetArrayRead(da,xloc,&ax));
+            PetscCall(DMDAVecGetArray(da,y,&ay));
+            for (j = info.ys; j < info.ys+info.ym; j++) {
+                for (i = info.xs; i < info.xs+info.xm; i++) {
+                    ay[j][i] = scdiag * ax[j][i];
+                    if (i==0 || i==info.mx-1 || j==0 || j==info.my-1)
+                        continue;
+                    if (i-1 > 0)          ay[j][i] -= sc[0] * ax[j][i-1];
+                    if (i+1 < info.mx-1)  ay[j][i] -= sc[0] * ax[j][i+1];
+                    if (j-1 > 0)          ay[j][i] -= sc[1] * ax[j-1][i];
+                    if (j+1 < info.my-1)  ay[j][i] -= sc[1] * ax[j+1][i];
+                }
+            }
+            PetscCall(DMDAVecRestoreArray(da,y,&ay));
+            PetscCall(DMDAVecRestoreArrayRead(da,xloc,&ax));
+            break;
+        }
+        case 3:
+        {
+            const PetscReal ***ax;
+            PetscReal       ***ay;
+            PetscCall(DMDAVecGetArrayRead(da,xloc,&ax));
+            PetscCall(DMDAVecGetArray(da,y,&ay));
+            // blocked as in Poisson3DFunctionLocal()
+            PetscCall(TileSizes(da,&tj,&tk));
+            if (tj == 0)  tj = info.ym;
+            if (tk == 0)  tk = info.zm;
+            for (kb = info.zs; kb < info.zs+info.zm; kb += tk) {
+                for (jb = info.ys; jb < info.ys+info.ym; jb += tj) {
+                    for (k = kb; k < PetscMin(kb+tk,info.zs+info.zm); k++) {
+                        for (j = jb; j < PetscMin(jb+tj,info.ys+info.ym); j++) {
+                            for (i = info.xs; i < info.xs+info.xm; i++) {
+                                ay[k][j][i] = scdiag * ax[k][j][i];
+                                if (   i==0 || i==info.mx-1
+                                    || j==0 || j==info.my-1
+                                    || k==0 || k==info.mz-1)
+                                    continue;
+                                if (i-1 > 0)          ay[k][j][i] -= sc[0] * ax[k][j][i-1];
+                                if (i+1 < info.mx-1)  ay[k][j][i] -= sc[0] * ax[k][j][i+1];
+                                if (j-1 > 0)          ay[k][j][i] -= sc[1] * ax[k][j-1][i];
+                                if (j+1 < info.my-1)  ay[k][j][i] -= sc[1] * ax[k][j+1][i];
+                                if (k-1 > 0)          ay[k][j][i] -= sc[2] * ax[k-1][j][i];
+                                if (k+1 < info.mz-1)  ay[k][j][i] -= sc[2] * ax[k+1][j][i];
+                            }
+                        }
+                    }
+                }
+            }
+            PetscCall(DMDAVecRestoreArray(da,y,&ay));
+            PetscCall(DMDAVecRestoreArrayRead(da,xloc,&ax));
+            break;
+        }
+        default:
+            SETERRQ(PETSC_COMM_SELF,6,"invalid dim from DMDALocalInfo\n");
+    }
+    PetscCall(DMRestoreLocalVector(da,&xloc));
+    PetscCall(PetscLogFlops((2.0*info.dim+1.0)*info.xm*info.ym*info.zm));
+    return 0;
+}
+
+PetscErrorCode PoissonShellGetDiagonal(Mat A, Vec d) {
+    PoissonCtx     *user;
+    DM             da;
+    DMDALocalInfo  info;
+    PetscReal      sc[3], scdiag;
+    PetscCall(MatShellGetContext(A,&user));
+    PetscCall(MatGetDM(A,&da));
+    PetscCall(DMDAGetLocalInfo(da,&info));
+    PetscCall(StencilCoefficients(&info,user,sc,&scdiag));
+    PetscCall(VecSet(d,scdiag));
+    return 0;
+}
+
+typedef struct {
+    DM         dak;      // same layout as the PC's DMDA but ghost width = sweeps
+    Vec        xloc;
+    PetscInt   sweeps;
+    PetscReal  omega;
+    PetscReal  *buf;     // three rows for each of levels 1,...,sweeps-1
+} FusedJacobiCtx;
+
+static PetscErrorCode FusedJacobiDestroyData(FusedJacobiCtx *fj) {
+    PetscCall(VecDestroy(&(fj->xloc)));
+    PetscCall(DMDestroy(&(fj->dak)));
+    PetscCall(PetscFree(fj->buf));
+    return 0;
+}
+
+// called from PCSetUp(), when the PC has its DMDA
+static PetscErrorCode FusedJacobiShellSetUp(PC pc) {
+    FusedJacobiCtx   *fj;
+    DM               da;
+    DMDALocalInfo    info;
+    const PetscInt   *lx, *ly;
+    PetscInt         m, n, small;
+
+    PetscCall(PCShellGetContext(pc,&fj));
+    PetscCall(FusedJacobiDestroyData(fj));
+    PetscCall(PCGetDM(pc,&da));
+    if (!da) {
+        SETERRQ(PETSC_COMM_SELF,10,"fused Jacobi smoother needs a DMDA\n");
+    }
+    PetscCall(DMDAGetLocalInfo(da,&info));
+    if (info.dim != 2) {
+        SETERRQ(PETSC_COMM_SELF,11,"fused Jacobi smoother is only implemented for dim 2\n");
+    }
+    PetscCall(DMDAGetInfo(da,NULL,NULL,NULL,NULL,&m,&n,NULL,NULL,NULL,
+                          NULL,NULL,NULL,NULL));
+    // the ghost region of width sweeps must come from the neighbor process
+    small = (   (m > 1 && info.xm < fj->sweeps)
+             || (n > 1 && info.ym < fj->sweeps)) ? 1 : 0;
+    PetscCall(MPI_Allreduce(MPI_IN_PLACE,&small,1,MPIU_INT,MPI_MAX,
+                            PetscObjectComm((PetscObject)da)));
+    if (small) {
+        SETERRQ(PetscObjectComm((PetscObject)da),12,
+                "fused Jacobi smoother with %d sweeps needs each process to own at least %d points\n"
+                "in each split direction, but the %d x %d grid is split %d x %d; use fewer sweeps,\n"
+                "or fewer multigrid levels (-pc_mg_levels)\n",
+                fj->sweeps,fj->sweeps,info.mx,info.my,m,n);
+    }
+    PetscCall(DMDAGetOwnershipRanges(da,&lx,&ly,NULL));
+    // box stencil because k sweeps of the 5-point stencil reach diagonally
+    PetscCall(DMDACreate2d(PetscObjectComm((PetscObject)da),
+                DM_BOUNDARY_NONE,DM_BOUNDARY_NONE,DMDA_STENCIL_BOX,
+                info.mx,info.my,m,n,1,fj->sweeps,lx,ly,&(fj->dak)));
+    PetscCall(DMSetUp(fj->dak));
+    PetscCall(DMCreateLocalVector(fj->dak,&(fj->xloc)));
+    PetscCall(DMDAGetLocalInfo(fj->dak,&info));
+    PetscCall(PetscMalloc1(3*(fj->sweeps-1)*info.gxm+1,&(fj->buf)));
+    return 0;
+}
+
+/* Apply  y = M^{-1} x  where M^{-1} is k sweeps of weighted Jacobi, from
+zero initial iterate, on the operator of PoissonShellMult().  Levels s of
+the sweep are computed as a wavefront over rows:  at each step the next row
+of level 1 is computed, and the row behind it of level 2, and so on, so that
+only three rows of each level are kept, and x is read and y written once.
+The ghost region of width k is updated once, after which level s is
+computed redundantly on the ghost rows and columns; its values there are
+wrong only within s of the edge of the ghost region. */
+static PetscErrorCode FusedJacobiApply(PC pc, Vec x, Vec y) {
+    FusedJacobiCtx   *fj;
+    DM               da;
+    DMDALocalInfo    info, infok;
+    PoissonCtx       *user;
+    PetscInt         k, s, i, j, jj, ilo, ihi, gxe, gye;
+    PetscReal        sc[3], scdiag, w, r, *out, *pc0, *pS, *pN,
+                     **ay;
+    const PetscReal  **ax, *xr;
+
+    PetscCall(PCShellGetContext(pc,&fj));
+    PetscCall(PCGetDM(pc,&da));
+    PetscCall(DMGetApplicationContext(da,&user));
+    PetscCall(DMDAGetLocalInfo(da,&info));
+    PetscCall(DMDAGetLocalInfo(fj->dak,&infok));
+    PetscCall(StencilCoefficients(&info,user,sc,&scdiag));
+    PetscCall(DMGlobalToLocal(fj->dak,x,INSERT_VALUES,fj->xloc));
+    PetscCall(DMDAVecGetArrayRead(fj->dak,fj->xloc,&ax));
+    PetscCall(DMDAVecGetArray(da,y,&ay));
+    k = fj->sweeps;
+    w = fj->omega;
+    gxe = infok.gxs + infok.gxm;
+    gye = infok.gys + infok.gym;
+// row j of level s, indexed by global i
+#define FJROW(s,j) (fj->buf + (3*((s)-1) + (j)%3) * infok.gxm - infok.gxs)
+    for (jj = infok.gys; jj < gye + k - 1; jj++) {
+        for (s = 1; s <= k; s++) {
+            j = jj - (s - 1);
+            if (j < infok.gys || j >= gye)
+                continue;
+            if (s == k) {
+                if (j < info.ys || j >= info.ys + info.ym)
+                    continue;
+                out = ay[j];
+                ilo = info.xs;
+                ihi = info.xs + info.xm;
+            } else {
+                out = FJROW(s,j);
+                ilo = infok.gxs;
+                ihi = gxe;
+            }
+            xr = ax[j];
+            if (s == 1) {  // first sweep from zero
+                for (i = ilo; i < ihi; i++)
+                    out[i] = w * xr[i] / scdiag;
+                continue;
+            }
+            pc0 = FJROW(s-1,j);
+            pS = (j-1 >= infok.gys && j-1 > 0)     ? FJROW(s-1,j-1) : NULL;
+            pN = (j+1 < gye        && j+1 < info.my-1) ? FJROW(s-1,j+1) : NULL;
+            for (i = ilo; i < ihi; i++) {
+                if (i==0 || i==info.mx-1 || j==0 || j==info.my-1) {
+                    out[i] = pc0[i] + w * (xr[i] / scdiag - pc0[i]);
+                    continue;
+                }
+                r = xr[i] - scdiag * pc0[i];
+                if (i-1 >= infok.gxs && i-1 > 0)  r += sc[0] * pc0[i-1];
+                if (i+1 < gxe && i+1 < info.mx-1) r += sc[0] * pc0[i+1];
+                if (pS)  r += sc[1] * pS[i];
+                if (pN)  r += sc[1] * pN[i];
+                out[i] = pc0[i] + w * r / scdiag;
+            }
+        }
+    }
+#undef FJROW
+    PetscCall(DMDAVecRestoreArray(da,y,&ay));
+    PetscCall(DMDAVecRestoreArrayRead(fj->dak,fj->xloc,&ax));
+    PetscCall(PetscLogFlops(11.0*k*infok.gxm*infok.gym));
+    return 0;
+}
+
+static PetscErrorCode FusedJacobiDestroy(PC pc) {
+    FusedJacobiCtx   *fj;
+    PetscCall(PCShellGetContext(pc,&fj));
+    PetscCall(FusedJacobiDestroyData(fj));
+    PetscCall(PetscFree(fj));
+    return 0;
+}
+
+static PetscErrorCode FusedJacobiView(PC pc, PetscViewer viewer) {
+    FusedJacobiCtx   *fj;
+    PetscBool        isascii;
+    PetscCall(PCShellGetContext(pc,&fj));
+    PetscCall(PetscObjectTypeCompare((PetscObject)viewer,PETSCVIEWERASCII,&isascii));
+    if (isascii) {
+        PetscCall(PetscViewerASCIIPrintf(viewer,
+                  "fused Jacobi: %d sweeps with omega = %g\n",
+                  fj->sweeps,(double)fj->omega));
+    }
+    return 0;
+}
+
+PetscErrorCode PoissonFusedJacobiSetUp(PC pc) {
+    FusedJacobiCtx   *fj;
+    const char       *prefix;
+    PetscBool        isshell;
+    PetscCall(PetscObjectTypeCompare((PetscObject)pc,PCSHELL,&isshell));
+    if (!isshell) {
+        SETERRQ(PETSC_COMM_SELF,13,
+                "fused Jacobi smoother must be set up on a PCSHELL\n");
+    }
+    PetscCall(PetscNew(&fj));
+    fj->sweeps = 2;
+    fj->omega = 0.8;   // optimal smoothing factor for the 5-point Laplacian
+    PetscCall(PCGetOptionsPrefix(pc,&prefix));
+    PetscOptionsBegin(PetscObjectComm((PetscObject)pc),prefix,
+                      "options for fused Jacobi smoother","");
+    PetscCall(PetscOptionsInt("-pc_fusedjacobi_sweeps",
+         "number k of weighted Jacobi sweeps in one application",
+         "poissonfunctions.c",fj->sweeps,&(fj->sweeps),NULL));
+    PetscCall(PetscOptionsReal("-pc_fusedjacobi_omega",
+         "weight of each Jacobi sweep",
+         "poissonfunctions.c",fj->omega,&(fj->omega),NULL));
+    PetscOptionsEnd();
+    if (fj->sweeps < 1) {
+        PetscCall(PetscFree(fj));
+        SETERRQ(PETSC_COMM_SELF,9,
+                "fused Jacobi smoother needs at least one sweep\n");
+    }
+    PetscCall(PCShellSetContext(pc,fj));
+    PetscCall(PCShellSetName(pc,"fusedjacobi"));
+    PetscCall(PCShellSetSetUp(pc,FusedJacobiShellSetUp));
+    PetscCall(PCShellSetApply(pc,FusedJacobiApply));
+    PetscCall(PCShellSetView(pc,FusedJacobiView));
+    PetscCall(PCShellSetDestroy(pc,FusedJacobiDestroy));
+    return 0;
+}
+
+// if Jpre is a MATSHELL, from DMCreateMatrix() under -dm_mat_type shell,
+//   make J and Jpre the matrix-free operator and return true
+static PetscErrorCode PoissonShellSetUp(Mat J, Mat Jpre, PoissonCtx *user,
+                                        PetscBool *isshell) {
+    PetscCall(PetscObjectTypeCompare((PetscObject)Jpre,MATSHELL,isshell));
+    if (!*isshell) {
+        return 0;
+    }
+    PetscCall(MatShellSetContext(Jpre,user));
+    PetscCall(MatShellSetOperation(Jpre,MATOP_MULT,(void(*)(void))PoissonShellMult));
+    PetscCall(MatShellSetOperation(Jpre,MATOP_GET_DIAGONAL,
+                                   (void(*)(void))PoissonShellGetDiagonal));
+    PetscCall(MatAssemblyBegin(Jpre,MAT_FINAL_ASSEMBLY));
+    PetscCall(MatAssemblyEnd(Jpre,MAT_FINAL_ASSEMBLY));
+    if (J != Jpre) {
+        PetscCall(MatAssemblyBegin(J,MAT_FINAL_ASSEMBLY));
+        PetscCall(MatAssemblyEnd(J,MAT_FINAL_ASSEMBLY));
+    }
+    return 0;
+}
+
 PetscErrorCode Poisson1DJacobianLocal(DMDALocalInfo *info, PetscScalar *au,
                                       Mat J, Mat Jpre, PoissonCtx *user) {
     PetscInt     i,ncols;
     PetscReal    xmin[1], xmax[1], h, v[3];
     MatStencil   col[3],row;
+    PetscBool    isshell;
 
+    PetscCall(PoissonShellSetUp(J,Jpre,user,&isshell));
+    if (isshell) {
+        return 0;
+    }
     PetscCall(DMGetBoundingBox(info->da,xmin,xmax));
     h = (xmax[0] - xmin[0]) / (info->mx - 1);
     for (i = info->xs; i < info->xs+info->xm; i++) {
@@ -154,7 +677,12 @@ PetscErrorCode Poisson2DJacobianLocal(DMDALocalInfo *info, PetscScalar **au,
     PetscReal   xymin[2], xymax[2], hx, hy, scx, scy, scdiag, v[5];
     PetscInt    i,j,ncols;
     MatStencil  col[5],row;
+    PetscBool   isshell;
 
+    PetscCall(PoissonShellSetUp(J,Jpre,user,&isshell));
+    if (isshell) {
+        return 0;
+    }
     PetscCall(DMGetBoundingBox(info->da,xymin,xymax));
     hx = (xymax[0] - xymin[0]) / (info->mx - 1);
     hy = (xymax[1] - xymin[1]) / (info->my - 1);
@@ -197,7 +725,12 @@ PetscErrorCode Poisson3DJacobianLocal(DMDALocalInfo *info, PetscScalar ***au,
     PetscReal   xyzmin[3], xyzmax[3], hx, hy, hz, dvol, scx, scy, scz, scdiag, v[7];
     PetscInt    i,j,k,ncols;
     MatStencil  col[7],row;
+    PetscBool   isshell;
 
+    PetscCall(PoissonShellSetUp(J,Jpre,user,&isshell));
+    if (isshell) {
+        return 0;
+    }
     PetscCall(DMGetBoundingBox(info->da,xyzmin,xyzmax));
     hx = (xyzmax[0] - xyzmin[0]) / (info->mx - 1);
     hy = (xyzmax[1] - xyzmin[1]) / (info->my - 1);
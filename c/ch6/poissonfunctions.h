@@ -24,6 +24,17 @@ designed as call-backs:
 A rough estimate is made of the number of flops in the functions
 PoissonXDFunctionLocal().
 
+In 2D and 3D the boundary values g and the right-hand side f are computed at
+the first residual evaluation on a DMDA and cached with it (each grid of
+-snes_grid_sequence or multigrid gets its own), so g_bdry() and f_rhs()
+must not change while that DMDA exists.
+
+In 3D the interior sweeps of the residual, and of the matrix-free operator
+below, can be cache-blocked by setting tile sizes in j and k:
+  ./fish -fsh_dim 3 -da_refine 6 -poisson_tile_j 16 -poisson_tile_k 64
+See ch6/study/tilebench.sh, which compares the memory bandwidth achieved
+with the STREAM benchmark.
+
 The PoissonXDJacobianLocal() functions are call-backs which assemble Jacobians
 for the same problems:
 
@@ -83,6 +94,34 @@ sparse matrix.  For example,
 PetscErrorCode Poisson3DJacobianLocal(DMDALocalInfo *info, PetscReal ***au,
                                       Mat J, Mat Jpre, PoissonCtx *user);
 
+/* Matrix-free versions of the above Jacobians.  If DMCreateMatrix() gives a
+MATSHELL, under option -dm_mat_type shell, then PoissonXDJacobianLocal()
+makes it apply the 3/5/7-point stencil directly on DMDA local arrays, with
+the same scaling scdiag of Dirichlet rows, instead of assembling it.  The
+diagonal (constant scdiag) is also available, for Jacobi and Chebyshev
+smoothers.  For example, multigrid with no assembled operator:
+    ./fish -fsh_dim 3 -dm_mat_type shell -pc_type mg -da_refine 4
+        -mg_levels_ksp_type chebyshev -mg_levels_pc_type jacobi
+        -mg_coarse_ksp_type cg -mg_coarse_pc_type jacobi              */
+PetscErrorCode PoissonShellMult(Mat A, Vec x, Vec y);
+PetscErrorCode PoissonShellGetDiagonal(Mat A, Vec d);
+
+/* A smoother which applies k sweeps of weighted Jacobi, from zero initial
+iterate, for the same operator, in one pass through memory.  The sweeps are
+computed as a wavefront over the rows of the local grid, after one update
+of a ghost region of width k.  PoissonFusedJacobiSetUp() turns a PCSHELL
+into this smoother, reading options -pc_fusedjacobi_sweeps (default 2) and
+-pc_fusedjacobi_omega (default 0.8) with the PC's prefix.  It requires the
+DMDA to have the PoissonCtx as its application context, and it is only
+implemented in 2D.  Each process must own at least k points in each split
+direction on every grid on which it is used.  In fish.c, option
+-fsh_fusedjacobi applies it on all non-coarse levels of PCMG, for example:
+    ./fish -da_refine 10 -pc_type mg -fsh_fusedjacobi
+        -mg_levels_ksp_type richardson -mg_levels_ksp_max_it 1
+        -mg_levels_pc_fusedjacobi_sweeps 3 -mg_levels_pc_fusedjacobi_omega 0.8
+See ch6/study/fusedsmoother.sh for a comparison with default smoothers.  */
+PetscErrorCode PoissonFusedJacobiSetUp(PC pc);
+
 /* The following function generates an initial iterate using either
   * zero
   * a random function (white noise; *no* smoothness)
@@ -0,0 +1,47 @@
+#!/bin/bash
+set -e
+
+# compare the fused multi-sweep Jacobi smoother (option -fsh_fusedjacobi,
+# from poissonfunctions.c) against PETSc's default and other standard smoothers,
+# in V-cycle multigrid for the 2D Poisson problem on a 2049x2049 grid;
+# reports KSP iterations, time in PCApply, and total time
+
+#   * use PETSC_ARCH with --with-debugging=0
+#   * run as:
+#         $ ./fusedsmoother.sh            # 1 process
+#         $ ./fusedsmoother.sh 4          # 4 processes
+
+NP=${1:-1}
+LEV=10
+K=3      # sweeps per smoothing step
+
+# each process must own at least K points across level 1, the coarsest
+#   smoothed level, which has 2^(LEV+3-NLEV)+1 points per direction
+NLEV=$((LEV+1))
+while (( ((1 << (LEV+3-NLEV)) + 1) / NP < K )); do
+    NLEV=$((NLEV-1))
+done
+
+COMMON="-da_refine $LEV -ksp_rtol 1.0e-10 -ksp_converged_reason -pc_type mg -pc_mg_levels $NLEV -log_view"
+
+function runcase() {
+    CMD="mpiexec -n $NP ../fish $COMMON $1"
+    echo "$CMD"
+    rm -f tmp.txt
+    /usr/bin/time -f "real %e" $CMD &> tmp.txt
+    grep "Linear solve" tmp.txt
+    grep "^PCApply " tmp.txt | awk '{print "  PCApply time " $4}'
+    grep "real" tmp.txt
+}
+
+# PETSc default:  Chebyshev + SOR
+runcase ""
+# Chebyshev + point Jacobi
+runcase "-mg_levels_pc_type jacobi"
+# Richardson + point Jacobi, K sweeps each streaming the level from memory
+runcase "-mg_levels_ksp_type richardson -mg_levels_ksp_richardson_scale 0.8 -mg_levels_ksp_max_it $K -mg_levels_pc_type jacobi"
+# Richardson + fused Jacobi, K sweeps in one pass
+runcase "-mg_levels_ksp_type richardson -mg_levels_ksp_max_it 1 -fsh_fusedjacobi -mg_levels_pc_fusedjacobi_sweeps $K"
+# Chebyshev + fused Jacobi
+runcase "-fsh_fusedjacobi -mg_levels_pc_fusedjacobi_sweeps $K"
+rm -f tmp.txt
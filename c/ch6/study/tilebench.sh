@@ -0,0 +1,47 @@
+#!/bin/bash
+set -e
+
+# microbenchmark for the cache-blocked 3D sweeps in poissonfunctions.c:  for
+# several tile sizes (-poisson_tile_j, -poisson_tile_k), measure the memory
+# bandwidth achieved by the residual Poisson3DFunctionLocal() and by the
+# matrix-free operator PoissonShellMult(), and compare to STREAM triad
+# bandwidth on the same node
+
+#   * use PETSC_ARCH with --with-debugging=0, and run on one process:
+#         $ ./tilebench.sh 6          # 129x129x129 grid
+#   * bandwidth is counted from compulsory traffic of the sweep only,
+#     namely 32 bytes/point for the residual (u, b, F and the write-allocate
+#     of F) and 24 bytes/point for the operator (x, y and the write-allocate
+#     of y); event times include the ghost update so these are lower bounds
+
+LEV=${1:-6}
+ITS=50
+
+# STREAM triad rate in MB/s from PETSc's own benchmark
+make -C $PETSC_DIR streams NPMAX=1 &> streams.txt
+STREAM=$(grep -i "triad" streams.txt | tail -n 1 | awk '{print $2}')
+echo "STREAM triad:  $STREAM MB/s"
+
+COMMON="-fsh_dim 3 -fsh_problem manupoly -da_refine $LEV -snes_type ksponly -ksp_type cg -pc_type none -ksp_max_it $ITS -log_view"
+
+# run fish, then report MB/s for log event $2 at $3 bytes/point
+function runcase() {
+    CMD="../fish $COMMON $1"
+    rm -f tmp.txt
+    $CMD &> tmp.txt
+    M=$(grep "point 3D grid" tmp.txt | awk '{print $4}')
+    grep "^$2 " tmp.txt | head -n 1 | \
+        awk -v m=$M -v b=$3 -v s=$STREAM '{ r = $2*m*m*m*b / $4 / 1.0e6;
+            printf "%8.1f MB/s (%5.1f%% of STREAM)\n", r, 100.0*r/s }'
+}
+
+for TILE in "0 0" "8 0" "16 0" "32 0" "16 16" "16 64"; do
+    set -- $TILE
+    T="-poisson_tile_j $1 -poisson_tile_k $2"
+    echo "tile j=$1 k=$2:"
+    echo -n "  residual: "
+    runcase "-snes_mf $T" SNESFunctionEval 32
+    echo -n "  operator: "
+    runcase "-dm_mat_type shell $T" MatMult 24
+done
+rm -f tmp.txt streams.txt
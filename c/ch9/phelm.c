@@ -107,10 +107,10 @@ int main(int argc,char **argv) {
                   "phelm.c",ProblemTypes,(PetscEnum)problem,(PetscEnum*)&problem,
                   NULL));
     PetscCall(PetscOptionsInt("-quadpts",
-                  "number n of quadrature points in each direction (= 1,2,3 only)",
+                  "number n of quadrature points in each direction (= 1,...,6)",
                   "phelm.c",user.quadpts,&(user.quadpts),NULL));
-    if ((user.quadpts < 1) || (user.quadpts > 3)) {
-        SETERRQ(PETSC_COMM_SELF,3,"quadrature points n=1,2,3 only");
+    if ((user.quadpts < 1) || (user.quadpts > MAXPTS)) {
+        SETERRQ(PETSC_COMM_SELF,3,"quadrature points n=1,...,6 only");
     }
     PetscCall(PetscOptionsBool("-view_f",
                   "view right-hand side to STDOUT",
@@ -38,10 +38,10 @@ PetscErrorCode ConfigureCtx(PLapCtx *user) {
                       "plap.c",user->eps,&(user->eps),NULL));
     PetscCall(PetscOptionsReal("-alpha","parameter alpha in exact solution",
                       "plap.c",user->alpha,&(user->alpha),NULL));
-    PetscCall(PetscOptionsInt("-quaddegree","quadrature degree n (= 1,2,3 only)",
+    PetscCall(PetscOptionsInt("-quaddegree","quadrature degree n (= 1,...,6)",
                      "plap.c",user->quaddegree,&(user->quaddegree),NULL));
-    if ((user->quaddegree < 1) || (user->quaddegree > 3)) {
-        SETERRQ(PETSC_COMM_WORLD,2,"quadrature degree n=1,2,3 only"); }
+    if ((user->quaddegree < 1) || (user->quaddegree > MAXPTS)) {
+        SETERRQ(PETSC_COMM_WORLD,2,"quadrature degree n=1,...,6 only"); }
     PetscCall(PetscOptionsBool("-no_residual","do not set the residual evaluation function",
                       "plap.c",user->no_residual,&(user->no_residual),NULL));
     PetscOptionsEnd();
@@ -2,7 +2,7 @@
 #define QUADRATURE_H_
 
 //STARTONEDIM
-#define MAXPTS 3
+#define MAXPTS 6
 
 typedef struct {
     PetscInt   n;          // number of quadrature points for this rule
@@ -10,20 +10,42 @@ typedef struct {
                w[MAXPTS];  // weights (sum to 2)
 } Quad1D;
 
-static const Quad1D gausslegendre[3]
+// gausslegendre[n-1] has n points and is exact for degree 2n-1
+static const Quad1D gausslegendre[6]
     = {  {1,
-          {0.0,                NAN,               NAN},
-          {2.0,                NAN,               NAN}},
+          {0.0,                NAN,               NAN,
+           NAN,                NAN,               NAN},
+          {2.0,                NAN,               NAN,
+           NAN,                NAN,               NAN}},
          {2,
-          {-0.577350269189626, 0.577350269189626, NAN},
-          {1.0,                1.0,               NAN}},
+          {-0.577350269189626, 0.577350269189626, NAN,
+           NAN,                NAN,               NAN},
+          {1.0,                1.0,               NAN,
+           NAN,                NAN,               NAN}},
          {3,
-          {-0.774596669241483, 0.0,               0.774596669241483},
-          {0.555555555555556,  0.888888888888889, 0.555555555555556}} };
+          {-0.774596669241483, 0.0,               0.774596669241483,
+           NAN,                NAN,               NAN},
+          {0.555555555555556,  0.888888888888889, 0.555555555555556,
+           NAN,                NAN,               NAN}},
+         {4,
+          {-0.861136311594053, -0.339981043584856, 0.339981043584856,
+           0.861136311594053,  NAN,                NAN},
+          {0.347854845137454,  0.652145154862546,  0.652145154862546,
+           0.347854845137454,  NAN,                NAN}},
+         {5,
+          {-0.906179845938664, -0.538469310105683, 0.0,
+           0.538469310105683,  0.906179845938664,  NAN},
+          {0.236926885056189,  0.478628670499366,  0.568888888888889,
+           0.478628670499366,  0.236926885056189,  NAN}},
+         {6,
+          {-0.932469514203152, -0.661209386466265, -0.238619186083197,
+           0.238619186083197,  0.661209386466265,  0.932469514203152},
+          {0.171324492379170,  0.360761573048139,  0.467913934572691,
+           0.467913934572691,  0.360761573048139,  0.171324492379170}} };
 //ENDONEDIM
 
 //STARTTRIANGLE
-#define MAXPTS_TRI 4
+#define MAXPTS_TRI 25
 
 typedef struct {
     PetscInt   n;               // number of quad. points for this rule
@@ -32,19 +54,138 @@ typedef struct {
                w[MAXPTS_TRI];   // weights (sum to 0.5)
 } Quad2DTri;
 
-static const Quad2DTri symmgauss[3]
+// symmgauss[d-1] is exact for polynomials of degree d; degrees 4 to 10
+//   are the rules of Dunavant (1985), with 6, 7, 12, 13, 16, 19, and 25
+//   points; entries beyond n are unused
+#define MAXDEGREE_TRI 10
+static const Quad2DTri symmgauss[MAXDEGREE_TRI]
     = {  {1,
-          {1.0/3.0,    NAN,       NAN,       NAN},
-          {1.0/3.0,    NAN,       NAN,       NAN},
-          {1.0/2.0,    NAN,       NAN,       NAN}},
+          {1.0/3.0,    NAN,       NAN,       NAN,       NAN,  NAN,  NAN},
+          {1.0/3.0,    NAN,       NAN,       NAN,       NAN,  NAN,  NAN},
+          {1.0/2.0,    NAN,       NAN,       NAN,       NAN,  NAN,  NAN}},
          {3,
-          {1.0/6.0,    2.0/3.0,   1.0/6.0,   NAN},
-          {1.0/6.0,    1.0/6.0,   2.0/3.0,   NAN},
-          {1.0/6.0,    1.0/6.0,   1.0/6.0,   NAN}},
+          {1.0/6.0,    2.0/3.0,   1.0/6.0,   NAN,       NAN,  NAN,  NAN},
+          {1.0/6.0,    1.0/6.0,   2.0/3.0,   NAN,       NAN,  NAN,  NAN},
+          {1.0/6.0,    1.0/6.0,   1.0/6.0,   NAN,       NAN,  NAN,  NAN}},
          {4,
-          {1.0/3.0,    1.0/5.0,   3.0/5.0,   1.0/5.0},
-          {1.0/3.0,    1.0/5.0,   1.0/5.0,   3.0/5.0},
-          {-27.0/96.0, 25.0/96.0, 25.0/96.0, 25.0/96.0}}  };
+          {1.0/3.0,    1.0/5.0,   3.0/5.0,   1.0/5.0,   NAN,  NAN,  NAN},
+          {1.0/3.0,    1.0/5.0,   1.0/5.0,   3.0/5.0,   NAN,  NAN,  NAN},
+          {-27.0/96.0, 25.0/96.0, 25.0/96.0, 25.0/96.0, NAN,  NAN,  NAN}},
+         {6,
+          {0.445948490915965, 0.108103018168070, 0.445948490915965,
+           0.091576213509771, 0.816847572980459, 0.091576213509771, NAN},
+          {0.445948490915965, 0.445948490915965, 0.108103018168070,
+           0.091576213509771, 0.091576213509771, 0.816847572980459, NAN},
+          {0.111690794839005, 0.111690794839005, 0.111690794839005,
+           0.054975871827661, 0.054975871827661, 0.054975871827661, NAN}},
+         {7,
+          {1.0/3.0,
+           0.470142064105115, 0.059715871789770, 0.470142064105115,
+           0.101286507323456, 0.797426985353087, 0.101286507323456},
+          {1.0/3.0,
+           0.470142064105115, 0.470142064105115, 0.059715871789770,
+           0.101286507323456, 0.101286507323456, 0.797426985353087},
+          {0.1125,
+           0.066197076394253, 0.066197076394253, 0.066197076394253,
+           0.062969590272414, 0.062969590272414, 0.062969590272414}},
+         {12,
+          {0.249286745170910, 0.501426509658180, 0.249286745170910,
+           0.063089014491502, 0.873821971016996, 0.063089014491502,
+           0.053145049844817, 0.310352451033784, 0.310352451033784,
+           0.636502499121399, 0.053145049844817, 0.636502499121399},
+          {0.249286745170910, 0.249286745170910, 0.501426509658180,
+           0.063089014491502, 0.063089014491502, 0.873821971016996,
+           0.310352451033784, 0.053145049844817, 0.636502499121399,
+           0.310352451033784, 0.636502499121399, 0.053145049844817},
+          {0.058393137863189, 0.058393137863189, 0.058393137863189,
+           0.025422453185103, 0.025422453185103, 0.025422453185103,
+           0.041425537809187, 0.041425537809187, 0.041425537809187,
+           0.041425537809187, 0.041425537809187, 0.041425537809187}},
+         {13,
+          {0.333333333333333, 0.260345966079040, 0.479308067841920,
+           0.260345966079040, 0.065130102902216, 0.869739794195568,
+           0.065130102902216, 0.048690315425316, 0.312865496004874,
+           0.312865496004874, 0.638444188569810, 0.048690315425316,
+           0.638444188569810},
+          {0.333333333333333, 0.260345966079040, 0.260345966079040,
+           0.479308067841920, 0.065130102902216, 0.065130102902216,
+           0.869739794195568, 0.312865496004874, 0.048690315425316,
+           0.638444188569810, 0.312865496004874, 0.638444188569810,
+           0.048690315425316},
+          {-0.074785022233841, 0.087807628716604, 0.087807628716604,
+           0.087807628716604, 0.026673617804419, 0.026673617804419,
+           0.026673617804419, 0.038556880445128, 0.038556880445128,
+           0.038556880445128, 0.038556880445128, 0.038556880445128,
+           0.038556880445128}},
+         {16,
+          {0.333333333333333, 0.459292588292723, 0.081414823414554,
+           0.459292588292723, 0.170569307751760, 0.658861384496480,
+           0.170569307751760, 0.050547228317031, 0.898905543365938,
+           0.050547228317031, 0.008394777409958, 0.263112829634638,
+           0.263112829634638, 0.728492392955404, 0.008394777409958,
+           0.728492392955404},
+          {0.333333333333333, 0.459292588292723, 0.459292588292723,
+           0.081414823414554, 0.170569307751760, 0.170569307751760,
+           0.658861384496480, 0.050547228317031, 0.050547228317031,
+           0.898905543365938, 0.263112829634638, 0.008394777409958,
+           0.728492392955404, 0.263112829634638, 0.728492392955404,
+           0.008394777409958},
+          {0.072157803838894, 0.047545817133642, 0.047545817133642,
+           0.047545817133642, 0.051608685267359, 0.051608685267359,
+           0.051608685267359, 0.016229248811599, 0.016229248811599,
+           0.016229248811599, 0.013615157087217, 0.013615157087217,
+           0.013615157087217, 0.013615157087217, 0.013615157087217,
+           0.013615157087217}},
+         {19,
+          {0.333333333333333, 0.489682519198738, 0.020634961602524,
+           0.489682519198738, 0.437089591492937, 0.125820817014126,
+           0.437089591492937, 0.188203535619033, 0.623592928761934,
+           0.188203535619033, 0.044729513394453, 0.910540973211094,
+           0.044729513394453, 0.036838412054736, 0.221962989160766,
+           0.221962989160766, 0.741198598784498, 0.036838412054736,
+           0.741198598784498},
+          {0.333333333333333, 0.489682519198738, 0.489682519198738,
+           0.020634961602524, 0.437089591492937, 0.437089591492937,
+           0.125820817014126, 0.188203535619033, 0.188203535619033,
+           0.623592928761934, 0.044729513394453, 0.044729513394453,
+           0.910540973211094, 0.221962989160766, 0.036838412054736,
+           0.741198598784498, 0.221962989160766, 0.741198598784498,
+           0.036838412054736},
+          {0.048567898141400, 0.015667350113570, 0.015667350113570,
+           0.015667350113570, 0.038913770502387, 0.038913770502387,
+           0.038913770502387, 0.039823869463605, 0.039823869463605,
+           0.039823869463605, 0.012788837829349, 0.012788837829349,
+           0.012788837829349, 0.021641769688645, 0.021641769688645,
+           0.021641769688645, 0.021641769688645, 0.021641769688645,
+           0.021641769688645}},
+         {25,
+          {0.333333333333333, 0.485577633383657, 0.028844733232686,
+           0.485577633383657, 0.109481575485037, 0.781036849029926,
+           0.109481575485037, 0.141707219414880, 0.307939838764121,
+           0.307939838764121, 0.550352941820999, 0.141707219414880,
+           0.550352941820999, 0.025003534762686, 0.246672560639903,
+           0.246672560639903, 0.728323904597411, 0.025003534762686,
+           0.728323904597411, 0.009540815400299, 0.066803251012200,
+           0.066803251012200, 0.923655933587501, 0.009540815400299,
+           0.923655933587501},
+          {0.333333333333333, 0.485577633383657, 0.485577633383657,
+           0.028844733232686, 0.109481575485037, 0.109481575485037,
+           0.781036849029926, 0.307939838764121, 0.141707219414880,
+           0.550352941820999, 0.307939838764121, 0.550352941820999,
+           0.141707219414880, 0.246672560639903, 0.025003534762686,
+           0.728323904597411, 0.246672560639903, 0.728323904597411,
+           0.025003534762686, 0.066803251012200, 0.009540815400299,
+           0.923655933587501, 0.066803251012200, 0.923655933587501,
+           0.009540815400299},
+          {0.045408995191377, 0.018362978878233, 0.018362978878233,
+           0.018362978878233, 0.022660529717764, 0.022660529717764,
+           0.022660529717764, 0.036378958422710, 0.036378958422710,
+           0.036378958422710, 0.036378958422710, 0.036378958422710,
+           0.036378958422710, 0.014163621265528, 0.014163621265528,
+           0.014163621265528, 0.014163621265528, 0.014163621265528,
+           0.014163621265528, 0.004710833481867, 0.004710833481867,
+           0.004710833481867, 0.004710833481867, 0.004710833481867,
+           0.004710833481867}}  };
 //ENDTRIANGLE
 
 #endif